@@ -46,7 +46,9 @@ uint32_t BoardSimpleGUI::generate_move(const Game& game)
 			if (x == UINT32_MAX) // invalid input
 				continue;
 			uint32_t index = BoardState::index(x, y);
-			print_liberties(get_cluster(game.get_cluster_table(), index));
+			const ClusterTable& table = game.get_cluster_table();
+			const Cluster& cluster = get_cluster(table, index);
+			print_liberties(get_liberties_map(table, cluster));
 		}
 		else if (command == "cluster")
 		{
@@ -56,9 +58,7 @@ uint32_t BoardSimpleGUI::generate_move(const Game& game)
 			uint32_t index = BoardState::index(x, y);
 			print_board(
 			    game.get_board_state(), game.get_game_state().player_turn);
-			print_cluster_info(
-			    index, game.get_cluster_table(),
-			    game.get_game_state().board_state);
+			print_cluster_info(index, game.get_cluster_table());
 		}
 		else if (command == "state")
 		{
@@ -230,7 +230,7 @@ void BoardSimpleGUI::print_game_state(const Game& game)
 	          << std::endl;
 }
 
-void BoardSimpleGUI::print_liberties(const Cluster& cluster)
+void BoardSimpleGUI::print_liberties(const LibertiesMap& liberties_map)
 {
 	clear_screen();
 	std::cout << "Liberty map" << std::endl;
@@ -257,9 +257,8 @@ void BoardSimpleGUI::print_liberties(const Cluster& cluster)
 
 		for (uint32_t j = 0; j < BOARD_SIZE; ++j)
 		{
-			if (cluster.liberties_map[BoardState::index(i, j)])
-				std::cout << cluster.liberties_map[BoardState::index(i, j)]
-				          << " ";
+			if (liberties_map.test(BoardState::index(i, j)))
+				std::cout << liberties_map.test(BoardState::index(i, j)) << " ";
 			else
 				std::cout << "-"
 				          << " ";
@@ -279,8 +278,7 @@ void BoardSimpleGUI::print_liberties(const Cluster& cluster)
 }
 
 void BoardSimpleGUI::print_cluster_info(
-    uint32_t index, const ClusterTable& table,
-    const go::engine::BoardState& state)
+    uint32_t index, const ClusterTable& table)
 {
 	const Cluster& cluster = get_cluster(table, index);
 
@@ -290,14 +288,14 @@ void BoardSimpleGUI::print_cluster_info(
 	uint32_t y = cluster.parent_idx % BOARD_SIZE;
 
 	std::cout << " = " << get_alphanumeric_position(x, y) << " ";
-	std::cout << "Player idx = " << cluster.player << std::endl;
+	std::cout << "Player idx = " << uint32_t(cluster.player) << std::endl;
 	std::cout << "Cluster size = " << cluster.size << std::endl;
 	std::cout << "Number of liberties = " << cluster.num_liberties << std::endl;
 	std::cout << "Cluster positions: " << std::endl;
 	std::cout << "[";
 
 	bool is_first_number = true;
-	for_each_cluster_cell(cluster, state, [&](uint32_t idx) {
+	for_each_cluster_cell(table, cluster, [&](uint32_t idx) {
 		x = idx / BOARD_SIZE;
 		y = idx % BOARD_SIZE;
 
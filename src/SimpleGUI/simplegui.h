@@ -38,12 +38,11 @@ private:
 	void print_board(const go::engine::BoardState& board, uint32_t player_turn);
 
 	// prints cluster liberties
-	void print_liberties(const go::engine::Cluster& cluster);
+	void print_liberties(const go::engine::LibertiesMap& liberties_map);
 
 	// prints cluster information
-	void print_cluster_info(
-	    uint32_t index, const go::engine::ClusterTable& table,
-	    const go::engine::BoardState& state);
+	void
+	print_cluster_info(uint32_t index, const go::engine::ClusterTable& table);
 
 	// transforms x and y to alphanumeric position
 	inline std::string get_alphanumeric_position(uint32_t x, uint32_t y);
@@ -13,6 +13,10 @@ class Agent
 public:
 	virtual ~Agent(){};
 	virtual uint32_t generate_move(const Game& game) = 0;
+	// called on both agents after a move of either player is played
+	virtual void on_move_played(const engine::Action& action)
+	{
+	}
 	uint32_t get_player_idx() const
 	{
 		return player_idx;
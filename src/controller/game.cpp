@@ -62,7 +62,12 @@ const engine::ClusterTable& Game::get_cluster_table() const
 
 bool Game::make_move(const Action& action)
 {
-	return engine::make_move(game_state, action);
+	if (!engine::make_move(game_state, action))
+		return false;
+	for (auto& agent : agents)
+		if (agent)
+			agent->on_move_played(action);
+	return true;
 }
 
 void Game::main_loop()
@@ -80,7 +85,7 @@ void Game::main_loop()
 		// accept the move only if played in time
 		if (!agent_time.is_overtime())
 		{
-			if (!engine::make_move(game_state, agent_action))
+			if (!make_move(agent_action))
 				DEBUG_PRINT("INVALID MOVE\n!");
 		}
 	}
@@ -0,0 +1,65 @@
+#include "bitboard.h"
+#include "interface.h"
+
+using namespace go::engine;
+
+template <uint32_t BoardSize>
+BasicBitboard<BoardSize> go::engine::get_cluster_stones(
+    const BasicBitboardState<BoardSize>& state, uint32_t cell_idx)
+{
+	const auto& player_stones = state.stones[0].test(cell_idx)
+	                                ? state.stones[0]
+	                                : state.stones[1];
+	BasicBitboard<BoardSize> seed;
+	seed.set(cell_idx);
+	return flood_fill(seed, player_stones);
+}
+
+template <uint32_t BoardSize>
+uint32_t go::engine::count_liberties(
+    const BasicBitboardState<BoardSize>& state, uint32_t cell_idx)
+{
+	BasicBitboard<BoardSize> cluster = get_cluster_stones(state, cell_idx);
+	return (expand(cluster) & state.get_empty_cells()).count();
+}
+
+template <uint32_t BoardSize>
+void go::engine::calculate_score(
+    const BasicBitboardState<BoardSize>& state, Player& black_player,
+    Player& white_player)
+{
+	uint32_t black_territory_score = 0, white_territory_score = 0;
+
+	// empty cells that don't belong to an already found region
+	BasicBitboard<BoardSize> remaining = state.get_empty_cells();
+	while (remaining.any())
+	{
+		BasicBitboard<BoardSize> seed;
+		seed.set(remaining.first());
+		BasicBitboard<BoardSize> region = flood_fill(seed, remaining);
+		remaining = and_not(remaining, region);
+
+		// a region belongs to a player if it only touches that player's stones
+		BasicBitboard<BoardSize> surrounding = expand(region);
+		bool touches_black = (surrounding & state.stones[0]).any();
+		bool touches_white = (surrounding & state.stones[1]).any();
+		if (!touches_black)
+			white_territory_score += region.count();
+		else if (!touches_white)
+			black_territory_score += region.count();
+	}
+
+	set_total_scores(
+	    black_territory_score, white_territory_score, black_player,
+	    white_player);
+}
+
+#define INSTANTIATE_BITBOARD(N)                                                \
+	template BasicBitboard<N> go::engine::get_cluster_stones(                  \
+	    const BasicBitboardState<N>&, uint32_t);                               \
+	template uint32_t go::engine::count_liberties(                             \
+	    const BasicBitboardState<N>&, uint32_t);                               \
+	template void go::engine::calculate_score(                                 \
+	    const BasicBitboardState<N>&, Player&, Player&);
+
+FOR_EACH_BOARD_SIZE(INSTANTIATE_BITBOARD)
@@ -0,0 +1,177 @@
+#ifndef SRC_ENGINE_BITBOARD_H_
+#define SRC_ENGINE_BITBOARD_H_
+
+#include <array>
+#include <stdint.h>
+
+#include "board.h"
+#include "utility.h"
+
+namespace go
+{
+namespace engine
+{
+
+// BasicBitboard is defined in board.h, as the game states store their
+// liberty maps and legal moves in it. This header adds whole board
+// operations and queries.
+
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize>
+operator|(const BasicBitboard<BoardSize>& a, const BasicBitboard<BoardSize>& b)
+{
+	BasicBitboard<BoardSize> result;
+	for (uint32_t i = 0; i < BasicBitboard<BoardSize>::NUM_WORDS; i++)
+		result.words[i] = a.words[i] | b.words[i];
+	return result;
+}
+
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize>
+operator&(const BasicBitboard<BoardSize>& a, const BasicBitboard<BoardSize>& b)
+{
+	BasicBitboard<BoardSize> result;
+	for (uint32_t i = 0; i < BasicBitboard<BoardSize>::NUM_WORDS; i++)
+		result.words[i] = a.words[i] & b.words[i];
+	return result;
+}
+
+// cells of a that are not in b
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize>
+and_not(const BasicBitboard<BoardSize>& a, const BasicBitboard<BoardSize>& b)
+{
+	BasicBitboard<BoardSize> result;
+	for (uint32_t i = 0; i < BasicBitboard<BoardSize>::NUM_WORDS; i++)
+		result.words[i] = a.words[i] & ~b.words[i];
+	return result;
+}
+
+// moves every cell idx to idx + offset, offset must be less than WORD_SIZE
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize>
+shift_forward(const BasicBitboard<BoardSize>& b, uint32_t offset)
+{
+	constexpr uint32_t WORD_SIZE = BasicBitboard<BoardSize>::WORD_SIZE;
+	BasicBitboard<BoardSize> result;
+	result.words[0] = b.words[0] << offset;
+	for (uint32_t i = 1; i < BasicBitboard<BoardSize>::NUM_WORDS; i++)
+		result.words[i] = (b.words[i] << offset) |
+		                  (b.words[i - 1] >> (WORD_SIZE - offset));
+	return result;
+}
+
+// moves every cell idx to idx - offset, offset must be less than WORD_SIZE
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize>
+shift_backward(const BasicBitboard<BoardSize>& b, uint32_t offset)
+{
+	constexpr uint32_t WORD_SIZE = BasicBitboard<BoardSize>::WORD_SIZE;
+	constexpr uint32_t LAST = BasicBitboard<BoardSize>::NUM_WORDS - 1;
+	BasicBitboard<BoardSize> result;
+	for (uint32_t i = 0; i < LAST; i++)
+		result.words[i] = (b.words[i] >> offset) |
+		                  (b.words[i + 1] << (WORD_SIZE - offset));
+	result.words[LAST] = b.words[LAST] >> offset;
+	return result;
+}
+
+namespace details
+{
+template <uint32_t BoardSize>
+constexpr BasicBitboard<BoardSize> make_on_board_bitboard()
+{
+	constexpr uint32_t SIZE = BasicBoardState<BoardSize>::MAX_BOARD_SIZE;
+	BasicBitboard<BoardSize> bitboard;
+	for (uint32_t i = 0; i < SIZE; i++)
+		for (uint32_t j = 0; j < SIZE; j++)
+			bitboard.set(BasicBoardState<BoardSize>::index(i, j));
+	return bitboard;
+}
+} // namespace details
+
+// all the cells inside the board, the border excluded
+template <uint32_t BoardSize>
+inline constexpr BasicBitboard<BoardSize> ON_BOARD =
+    details::make_on_board_bitboard<BoardSize>();
+
+// the cells of b and their neighbors inside the board
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize> expand(const BasicBitboard<BoardSize>& b)
+{
+	constexpr uint32_t ROW = BasicBoardState<BoardSize>::EXTENDED_BOARD_SIZE;
+	// moving cells across a row end lands them on the border, which is then
+	// masked out
+	BasicBitboard<BoardSize> result =
+	    b | shift_forward(b, 1) | shift_backward(b, 1) |
+	    shift_forward(b, ROW) | shift_backward(b, ROW);
+	return result & ON_BOARD<BoardSize>;
+}
+
+// the cells of mask connected to seed, going through cells of mask only
+template <uint32_t BoardSize>
+inline BasicBitboard<BoardSize> flood_fill(
+    const BasicBitboard<BoardSize>& seed, const BasicBitboard<BoardSize>& mask)
+{
+	BasicBitboard<BoardSize> region = seed & mask;
+	while (true)
+	{
+		BasicBitboard<BoardSize> next = expand(region) & mask;
+		if (next == region)
+			return region;
+		region = next;
+	}
+}
+
+// Board representation with one bitboard per player
+template <uint32_t BoardSize>
+struct BasicBitboardState
+{
+	std::array<BasicBitboard<BoardSize>, 2> stones;
+
+	explicit BasicBitboardState(const BasicBoardState<BoardSize>& state)
+	{
+		for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS;
+		     i++)
+		{
+			Cell cell = state.board[i];
+			if (cell == Cell::BLACK || cell == Cell::WHITE)
+				stones[get_player_index(cell)].set(i);
+		}
+	}
+
+	BasicBitboard<BoardSize> get_empty_cells() const
+	{
+		return and_not(ON_BOARD<BoardSize>, stones[0] | stones[1]);
+	}
+};
+
+using BitboardState = BasicBitboardState<DEFAULT_BOARD_SIZE>;
+
+// stones of the cluster containing the stone at cell_idx
+template <uint32_t BoardSize>
+BasicBitboard<BoardSize> get_cluster_stones(
+    const BasicBitboardState<BoardSize>& state, uint32_t cell_idx);
+
+template <uint32_t BoardSize>
+uint32_t
+count_liberties(const BasicBitboardState<BoardSize>& state, uint32_t cell_idx);
+
+// Same as calculate_score(const BoardState&, ...), with the territory found by
+// flood filling bitboards instead of a cell by cell search
+template <uint32_t BoardSize>
+void calculate_score(const BasicBitboardState<BoardSize>&, Player&, Player&);
+
+template <uint32_t BoardSize, typename Lambda>
+void for_each_cluster_cell(
+    const BasicBitboardState<BoardSize>& state, uint32_t cell_idx,
+    Lambda&& lambda)
+{
+	for_each_cell(
+	    get_cluster_stones(state, cell_idx), std::forward<Lambda>(lambda));
+}
+
+} // namespace engine
+} // namespace go
+
+#endif // SRC_ENGINE_BITBOARD_H_
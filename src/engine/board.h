@@ -3,9 +3,10 @@
 
 #include <array>
 #include <assert.h>
-#include <bitset>
 #include <stdint.h>
-#include <vector>
+#include <type_traits>
+
+#include "pattern.h"
 
 #ifndef NDEBUG
 #include <stdio.h>
@@ -32,18 +33,47 @@ enum class Cell : unsigned char
 
 static constexpr Cell PLAYERS[] = {Cell::BLACK, Cell::WHITE};
 
-struct BoardState
+inline uint32_t get_player_index(Cell stone)
+{
+	return stone == PLAYERS[0] ? 0 : 1;
+}
+
+// Board sizes the engine is built for, MACRO is expanded once per size to
+// instantiate the engine templates
+#define FOR_EACH_BOARD_SIZE(MACRO) MACRO(9) MACRO(13) MACRO(19)
+// Same, once per board size and liberty model, see ExactLiberties
+#define FOR_EACH_LIBERTY_MODEL(MACRO)                                          \
+	MACRO(9, ExactLiberties)                                                   \
+	MACRO(9, PseudoLiberties)                                                  \
+	MACRO(13, ExactLiberties)                                                  \
+	MACRO(13, PseudoLiberties)                                                 \
+	MACRO(19, ExactLiberties)                                                  \
+	MACRO(19, PseudoLiberties)
+
+static constexpr uint32_t MAX_SUPPORTED_BOARD_SIZE = 19;
+static constexpr uint32_t DEFAULT_BOARD_SIZE = 19;
+
+template <uint32_t BoardSize>
+struct BasicBoardState
 {
-	static constexpr uint32_t MAX_BOARD_SIZE = 19;
+	static constexpr uint32_t MAX_BOARD_SIZE = BoardSize;
 	static constexpr uint32_t EXTENDED_BOARD_SIZE = MAX_BOARD_SIZE + 2;
 	static constexpr uint32_t MAX_NUM_CELLS =
 	    EXTENDED_BOARD_SIZE * EXTENDED_BOARD_SIZE;
-	static constexpr uint32_t INVALID_INDEX = MAX_NUM_CELLS;
+	// games longer than this are ended
+	static constexpr uint32_t MAX_NUM_MOVES =
+	    MAX_BOARD_SIZE * MAX_BOARD_SIZE * 4;
+	// the same for all board sizes, past the cells of the largest board, so
+	// that actions don't depend on the board size
+	static constexpr uint32_t INVALID_INDEX =
+	    (MAX_SUPPORTED_BOARD_SIZE + 2) * (MAX_SUPPORTED_BOARD_SIZE + 2);
+
+	static_assert(BoardSize <= MAX_SUPPORTED_BOARD_SIZE);
 
 	std::array<Cell, MAX_NUM_CELLS> board;
 	uint32_t ko;
 
-	BoardState() : ko{INVALID_INDEX}
+	BasicBoardState() : ko{INVALID_INDEX}
 	{
 		std::fill(board.begin(), board.end(), Cell::EMPTY);
 		for (uint32_t i = 0; i < EXTENDED_BOARD_SIZE; i++)
@@ -71,17 +101,125 @@ struct BoardState
 		return board[index(i, j)];
 	}
 
-	static uint32_t index(uint32_t i, uint32_t j)
+	static constexpr uint32_t index(uint32_t i, uint32_t j)
 	{
 		return (i + 1) * EXTENDED_BOARD_SIZE + (j + 1);
 	}
 };
 
+using BoardState = BasicBoardState<DEFAULT_BOARD_SIZE>;
+
+namespace details
+{
+inline uint32_t popcount(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<uint32_t>(__builtin_popcountll(word));
+#else
+	uint32_t count = 0;
+	for (; word != 0; word &= word - 1)
+		count++;
+	return count;
+#endif
+}
+
+inline uint32_t count_trailing_zeros(uint64_t word)
+{
+	assert(word != 0);
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<uint32_t>(__builtin_ctzll(word));
+#else
+	uint32_t count = 0;
+	for (; (word & 1) == 0; word >>= 1)
+		count++;
+	return count;
+#endif
+}
+
+constexpr uint32_t next_power_of_two(uint32_t value)
+{
+	uint32_t power = 1;
+	while (power < value)
+		power *= 2;
+	return power;
+}
+} // namespace details
+
+// One bit per cell of the extended board, using the same indices as
+// BoardState::board. Whole board operations work on 64 cells at a time.
+template <uint32_t BoardSize>
+struct BasicBitboard
+{
+	static constexpr uint32_t WORD_SIZE = 64;
+	static constexpr uint32_t NUM_WORDS =
+	    (BasicBoardState<BoardSize>::MAX_NUM_CELLS + WORD_SIZE - 1) /
+	    WORD_SIZE;
+
+	std::array<uint64_t, NUM_WORDS> words = {};
+
+	constexpr bool test(uint32_t idx) const
+	{
+		return (words[idx / WORD_SIZE] >> (idx % WORD_SIZE)) & 1;
+	}
+	constexpr void set(uint32_t idx)
+	{
+		words[idx / WORD_SIZE] |= uint64_t(1) << (idx % WORD_SIZE);
+	}
+	constexpr void reset(uint32_t idx)
+	{
+		words[idx / WORD_SIZE] &= ~(uint64_t(1) << (idx % WORD_SIZE));
+	}
+	void reset()
+	{
+		words.fill(0);
+	}
+	bool any() const
+	{
+		for (uint64_t word : words)
+			if (word != 0)
+				return true;
+		return false;
+	}
+	uint32_t count() const
+	{
+		uint32_t count = 0;
+		for (uint64_t word : words)
+			count += details::popcount(word);
+		return count;
+	}
+	// index of the lowest set cell, the bitboard must not be empty
+	uint32_t first() const
+	{
+		uint32_t i = 0;
+		while (words[i] == 0)
+			i++;
+		return i * WORD_SIZE + details::count_trailing_zeros(words[i]);
+	}
+	BasicBitboard& operator|=(const BasicBitboard& other)
+	{
+		for (uint32_t i = 0; i < NUM_WORDS; i++)
+			words[i] |= other.words[i];
+		return *this;
+	}
+	bool operator==(const BasicBitboard& other) const
+	{
+		return words == other.words;
+	}
+	bool operator!=(const BasicBitboard& other) const
+	{
+		return words != other.words;
+	}
+};
+
+using Bitboard = BasicBitboard<DEFAULT_BOARD_SIZE>;
+
 inline bool is_empty_cell(Cell cell)
 {
 	return cell == Cell::EMPTY;
 }
-inline bool is_empty_cell(const BoardState& state, uint32_t idx)
+template <uint32_t BoardSize>
+inline bool
+is_empty_cell(const BasicBoardState<BoardSize>& state, uint32_t idx)
 {
 	return is_empty_cell(state.board[idx]);
 }
@@ -98,30 +236,117 @@ inline bool is_pass(const Action& action)
 	return action.pos == Action::PASS;
 }
 
+// true if the action is neither a pass nor a cell of the board
+template <uint32_t BoardSize>
 inline bool is_invalid(const Action& action)
 {
-	return action.pos > BoardState::INVALID_INDEX || action.player_index > 1;
+	return (action.pos >= BasicBoardState<BoardSize>::MAX_NUM_CELLS &&
+	        !is_pass(action)) ||
+	       action.player_index > 1;
 }
 
-// A cluster is a maximal set of connected stones
+template <uint32_t BoardSize>
+using BasicLibertiesMap = BasicBitboard<BoardSize>;
+using LibertiesMap = BasicLibertiesMap<DEFAULT_BOARD_SIZE>;
+
+// A cluster is a maximal set of connected stones. Every stone's parent_idx is
+// the cluster's root (the cell whose parent_idx is itself), the other fields
+// are only meaningful in the root's entry
 struct Cluster
 {
-	mutable uint32_t parent_idx;
-	uint32_t player;
-	uint32_t size;
-	uint32_t num_liberties;
-	std::bitset<BoardState::MAX_NUM_CELLS> liberties_map;
+	uint16_t parent_idx;
+	uint16_t size;
+	// number of liberties, or of pseudo liberties, see ExactLiberties
+	uint16_t num_liberties;
+	// slot in ClusterTable::liberties owned by the cluster, only used with
+	// exact liberties
+	uint16_t liberties_idx;
+	uint8_t player;
+};
+
+// Liberty models of a cluster table. With exact liberties, every cluster has
+// a map of its liberties and num_liberties is their number. With pseudo
+// liberties, an empty cell is counted once per stone next to it, and the
+// table keeps the sum of the pseudo liberties of each cluster and of their
+// squares. They are cheaper to update and still tell exactly whether a
+// cluster has no liberty or a single one, and where it is.
+struct ExactLiberties
+{
+};
+struct PseudoLiberties
+{
+};
+
+namespace details
+{
+template <uint32_t BoardSize, typename Liberties>
+struct LibertyStorage;
+
+template <uint32_t BoardSize>
+struct LibertyStorage<BoardSize, ExactLiberties>
+{
+	// Every cluster has at least one liberty, and an empty cell is a liberty
+	// of at most 4 clusters, so there can't be more than 4 clusters per 5
+	// cells. The bound is reached, up to the edges, by leaving every cell
+	// with (row + 2 * column) % 5 == 0 empty and coloring the other cells
+	// as a checkerboard: each stone is then a cluster of its own, with a
+	// liberty. A legal position can thus fill all but O(BoardSize) of the
+	// slots, so there is no smaller pool to fall back from. One more is
+	// needed while a move is played, as the new stone gets its cluster
+	// before the captured ones are removed
+	static constexpr uint32_t MAX_NUM_CLUSTERS =
+	    BoardSize * BoardSize * 4 / 5 + 1;
+
+	// liberty maps of the live clusters
+	std::array<BasicLibertiesMap<BoardSize>, MAX_NUM_CLUSTERS> liberties;
+	// stack of the unused slots of liberties
+	std::array<uint16_t, MAX_NUM_CLUSTERS> free_liberties;
+	uint32_t num_free_liberties;
+
+	LibertyStorage() : liberties{}, num_free_liberties{MAX_NUM_CLUSTERS}
+	{
+		for (uint32_t i = 0; i < MAX_NUM_CLUSTERS; i++)
+			free_liberties[i] = uint16_t(MAX_NUM_CLUSTERS - 1 - i);
+	}
 };
 
+template <uint32_t BoardSize>
+struct LibertyStorage<BoardSize, PseudoLiberties>
+{
+	static constexpr uint32_t MAX_NUM_CELLS =
+	    BasicBoardState<BoardSize>::MAX_NUM_CELLS;
+
+	// sums of the pseudo liberties of each cluster and of their squares,
+	// only meaningful in the root's entry
+	std::array<uint32_t, MAX_NUM_CELLS> liberty_sums;
+	std::array<uint32_t, MAX_NUM_CELLS> liberty_square_sums;
+
+	LibertyStorage() : liberty_sums{}, liberty_square_sums{}
+	{
+	}
+};
+} // namespace details
+
 // A union find structure
-struct ClusterTable
+template <uint32_t BoardSize, typename Liberties = ExactLiberties>
+struct BasicClusterTable : details::LibertyStorage<BoardSize, Liberties>
 {
+	using BoardState = BasicBoardState<BoardSize>;
+
 	std::array<Cluster, BoardState::MAX_NUM_CELLS> clusters;
-	ClusterTable() : clusters{} // initialize clusters to 0
+	// links the stones of each cluster in a circular list, so that a
+	// cluster's stones can be walked and two clusters joined in O(1)
+	std::array<uint16_t, BoardState::MAX_NUM_CELLS> next_stone;
+
+	BasicClusterTable()
+	    : clusters{}, // initialize clusters to 0
+	      next_stone{}
 	{
 	}
 };
 
+using ClusterTable = BasicClusterTable<DEFAULT_BOARD_SIZE>;
+
 struct Player
 {
 	uint32_t number_captured_enemies;
@@ -134,23 +359,495 @@ struct Player
 	}
 };
 
-struct GameState
+// Indexed list of the empty cells of the board, cells are added and removed
+// in O(1) by swapping with the last element
+template <uint32_t BoardSize>
+struct BasicEmptyCells
+{
+	using BoardState = BasicBoardState<BoardSize>;
+
+	std::array<uint16_t, BoardState::MAX_NUM_CELLS> cells;
+	// position of each empty cell in cells
+	std::array<uint16_t, BoardState::MAX_NUM_CELLS> positions;
+	uint32_t size;
+
+	// all cells inside the board start empty
+	BasicEmptyCells() : size{0}
+	{
+		for (uint32_t i = 0; i < BoardState::MAX_BOARD_SIZE; i++)
+			for (uint32_t j = 0; j < BoardState::MAX_BOARD_SIZE; j++)
+				insert(BoardState::index(i, j));
+	}
+
+	void insert(uint32_t cell_idx)
+	{
+		positions[cell_idx] = uint16_t(size);
+		cells[size++] = uint16_t(cell_idx);
+	}
+
+	void remove(uint32_t cell_idx)
+	{
+		uint16_t last = cells[--size];
+		cells[positions[cell_idx]] = last;
+		positions[last] = positions[cell_idx];
+	}
+};
+
+using EmptyCells = BasicEmptyCells<DEFAULT_BOARD_SIZE>;
+
+// Indexed list of the roots of the clusters with a single liberty, along with
+// that liberty. Same layout as BasicEmptyCells
+template <uint32_t BoardSize>
+struct BasicAtariClusters
+{
+	using BoardState = BasicBoardState<BoardSize>;
+	static constexpr uint16_t NOT_IN_ATARI = UINT16_MAX;
+
+	std::array<uint16_t, BoardState::MAX_NUM_CELLS> roots;
+	// position of each root in roots, NOT_IN_ATARI if it isn't in the list
+	std::array<uint16_t, BoardState::MAX_NUM_CELLS> positions;
+	// the liberty of each cluster in the list, indexed by its root
+	std::array<uint16_t, BoardState::MAX_NUM_CELLS> liberties;
+	uint32_t size;
+
+	BasicAtariClusters() : size{0}
+	{
+		positions.fill(NOT_IN_ATARI);
+	}
+
+	bool contains(uint32_t root) const
+	{
+		return positions[root] != NOT_IN_ATARI;
+	}
+
+	// adds the cluster, or updates its liberty if it is already in the list
+	void insert(uint32_t root, uint32_t liberty)
+	{
+		if (!contains(root))
+		{
+			positions[root] = uint16_t(size);
+			roots[size++] = uint16_t(root);
+		}
+		liberties[root] = uint16_t(liberty);
+	}
+
+	void remove(uint32_t root)
+	{
+		if (!contains(root))
+			return;
+		uint16_t last = roots[--size];
+		roots[positions[root]] = last;
+		positions[last] = positions[root];
+		positions[root] = NOT_IN_ATARI;
+	}
+};
+
+using AtariClusters = BasicAtariClusters<DEFAULT_BOARD_SIZE>;
+
+// Fixed capacity list stored inline, so that the structs holding it stay
+// trivially copyable
+template <typename T, uint32_t Capacity>
+struct FixedList
+{
+	std::array<T, Capacity> items;
+	uint32_t count;
+
+	FixedList() : count{0}
+	{
+	}
+
+	uint32_t size() const
+	{
+		return count;
+	}
+	bool empty() const
+	{
+		return count == 0;
+	}
+	bool full() const
+	{
+		return count == Capacity;
+	}
+	void push_back(const T& item)
+	{
+		assert(!full());
+		items[count++] = item;
+	}
+	void pop_back()
+	{
+		assert(!empty());
+		count--;
+	}
+	void clear()
+	{
+		count = 0;
+	}
+	// only shrinks the list
+	void resize(uint32_t new_size)
+	{
+		assert(new_size <= count);
+		count = new_size;
+	}
+	T& operator[](uint32_t i)
+	{
+		assert(i < count);
+		return items[i];
+	}
+	const T& operator[](uint32_t i) const
+	{
+		assert(i < count);
+		return items[i];
+	}
+	const T& back() const
+	{
+		return (*this)[count - 1];
+	}
+	const T* begin() const
+	{
+		return items.data();
+	}
+	const T* end() const
+	{
+		return items.data() + count;
+	}
+};
+
+// unmake_move takes back at most this many moves in a row
+static constexpr uint32_t MAX_UNDO_MOVES = 256;
+
+// Stones captured by the last moves, indexed by their order of capture since
+// the start of the game. Only the last CAPACITY are kept: the last
+// MAX_UNDO_MOVES moves capture at most the stones on the board before them
+// and the ones they place.
+template <uint32_t BoardSize>
+struct CapturedStones
+{
+	static constexpr uint32_t CAPACITY =
+	    BasicBoardState<BoardSize>::MAX_NUM_CELLS + MAX_UNDO_MOVES;
+
+	std::array<uint16_t, CAPACITY> stones;
+	uint32_t count;
+
+	CapturedStones() : count{0}
+	{
+	}
+
+	uint32_t size() const
+	{
+		return count;
+	}
+	void push_back(uint16_t stone)
+	{
+		stones[count++ % CAPACITY] = stone;
+	}
+	// forgets the stones captured from index new_size on
+	void resize(uint32_t new_size)
+	{
+		assert(new_size <= count);
+		count = new_size;
+	}
+	uint16_t operator[](uint32_t i) const
+	{
+		assert(i < count && count - i <= CAPACITY);
+		return stones[i % CAPACITY];
+	}
+};
+
+// What a move changed, enough to revert it with unmake_move
+struct MoveRecord
+{
+	// index of the first stone captured by the move in
+	// BasicJournal::captured_stones
+	uint32_t captured_begin;
+	// cell played, or Action::PASS
+	uint16_t pos;
+	// ko point before the move
+	uint16_t ko;
+	// number of passes ending the game before the move
+	uint16_t consecutive_passes;
+	uint8_t player_index;
+	uint8_t merged_count;
+	uint8_t captured_count;
+	// roots of the friend clusters merged with the played stone
+	std::array<uint16_t, 4> merged_roots;
+	// roots of the captured enemy clusters
+	std::array<uint16_t, 4> captured_roots;
+
+	Action get_action() const
+	{
+		return {pos, player_index};
+	}
+};
+
+static_assert(Action::PASS <= UINT16_MAX);
+
+// What a move would do, see analyze_move
+struct MoveEffect
+{
+	// roots of the enemy clusters captured by the move
+	std::array<uint16_t, 4> captured_roots;
+	uint32_t captured_count;
+	uint32_t num_captured_stones;
+	// liberties of the played stone's cluster, after merging with the friend
+	// clusters around and removing the captured ones
+	uint32_t num_liberties;
+	// the played stone's cluster is left with a single liberty
+	bool is_self_atari;
+	// ko point after the move, BoardState::INVALID_INDEX if none
+	uint32_t ko;
+};
+
+// The records of the last MAX_UNDO_MOVES moves, the older ones are
+// overwritten as the game goes on
+template <uint32_t BoardSize>
+struct BasicJournal
+{
+	std::array<MoveRecord, MAX_UNDO_MOVES> records;
+	// moves recorded since the start of the game
+	uint32_t num_moves;
+	// records that can still be taken back
+	uint32_t num_records;
+	CapturedStones<BoardSize> captured_stones;
+
+	BasicJournal() : num_moves{0}, num_records{0}
+	{
+	}
+
+	bool empty() const
+	{
+		return num_records == 0;
+	}
+	void push_back(const MoveRecord& record)
+	{
+		records[num_moves++ % MAX_UNDO_MOVES] = record;
+		if (num_records < MAX_UNDO_MOVES)
+			num_records++;
+	}
+	void pop_back()
+	{
+		assert(!empty());
+		num_moves--;
+		num_records--;
+	}
+	const MoveRecord& back() const
+	{
+		assert(!empty());
+		return records[(num_moves - 1) % MAX_UNDO_MOVES];
+	}
+};
+
+// Fixed capacity list of moves, each packed in 16 bits: the cell index in
+// the low bits and the player in the top bit
+template <uint32_t Capacity>
+struct MoveHistory
+{
+	static constexpr uint16_t PLAYER_BIT = 1 << 15;
+	static_assert(Action::PASS < PLAYER_BIT);
+
+	std::array<uint16_t, Capacity> moves;
+	uint32_t size;
+
+	MoveHistory() : size{0}
+	{
+	}
+
+	bool empty() const
+	{
+		return size == 0;
+	}
+	bool full() const
+	{
+		return size == Capacity;
+	}
+	void push_back(const Action& action)
+	{
+		assert(!full());
+		moves[size++] = uint16_t(action.pos | action.player_index << 15);
+	}
+	void pop_back()
+	{
+		assert(!empty());
+		size--;
+	}
+	Action operator[](uint32_t i) const
+	{
+		assert(i < size);
+		uint16_t move = moves[i];
+		return {uint32_t(move & (PLAYER_BIT - 1)), uint32_t(move >> 15)};
+	}
+	Action back() const
+	{
+		return (*this)[size - 1];
+	}
+};
+
+// Fixed capacity list of position hashes, indexed by an open addressed table
+// so that finding a hash doesn't scan the list. Each slot holds the index
+// plus one of the first occurrence of a hash, 0 for an empty slot.
+template <uint32_t Capacity>
+struct HashHistory
 {
+	// more slots than hashes, so that probing always ends on an empty slot
+	static constexpr uint32_t NUM_SLOTS =
+	    details::next_power_of_two(Capacity + 1);
+	static constexpr uint32_t SLOT_MASK = NUM_SLOTS - 1;
+	static constexpr uint16_t EMPTY_SLOT = 0;
+	static_assert(Capacity < UINT16_MAX);
+
+	std::array<uint64_t, Capacity> hashes;
+	std::array<uint16_t, NUM_SLOTS> slots;
+	uint32_t count;
+
+	HashHistory() : slots{}, count{0}
+	{
+	}
+
+	uint32_t size() const
+	{
+		return count;
+	}
+	bool empty() const
+	{
+		return count == 0;
+	}
+	bool full() const
+	{
+		return count == Capacity;
+	}
+	bool contains(uint64_t hash) const
+	{
+		return slots[find_slot(hash)] != EMPTY_SLOT;
+	}
+	void push_back(uint64_t hash)
+	{
+		assert(!full());
+		const uint32_t slot = find_slot(hash);
+		if (slots[slot] == EMPTY_SLOT)
+			slots[slot] = uint16_t(count + 1);
+		hashes[count++] = hash;
+	}
+	void pop_back()
+	{
+		assert(!empty());
+		count--;
+		// repeated hashes only have a slot for their first occurrence
+		const uint32_t slot = find_slot(hashes[count]);
+		if (slots[slot] == count + 1)
+			erase_slot(slot);
+	}
+	uint64_t operator[](uint32_t i) const
+	{
+		assert(i < count);
+		return hashes[i];
+	}
+	uint64_t back() const
+	{
+		return (*this)[count - 1];
+	}
+
+private:
+	static uint32_t home_slot(uint64_t hash)
+	{
+		return uint32_t(hash) & SLOT_MASK;
+	}
+	// the slot of the hash, or the empty slot ending its probe sequence
+	uint32_t find_slot(uint64_t hash) const
+	{
+		uint32_t slot = home_slot(hash);
+		while (slots[slot] != EMPTY_SLOT && hashes[slots[slot] - 1] != hash)
+			slot = (slot + 1) & SLOT_MASK;
+		return slot;
+	}
+	// empties the slot, moving back the following entries of the probe
+	// sequence that can't be found past the hole otherwise
+	void erase_slot(uint32_t hole)
+	{
+		uint32_t next = (hole + 1) & SLOT_MASK;
+		for (; slots[next] != EMPTY_SLOT; next = (next + 1) & SLOT_MASK)
+		{
+			const uint32_t home = home_slot(hashes[slots[next] - 1]);
+			if (((next - home) & SLOT_MASK) >= ((next - hole) & SLOT_MASK))
+			{
+				slots[hole] = slots[next];
+				hole = next;
+			}
+		}
+		slots[hole] = EMPTY_SLOT;
+	}
+};
+
+// The part of the game state needed to play moves by the rules. It has no
+// history and is trivially copyable, so that a random playout can start
+// from a copy of a game state, which is a single memcpy.
+template <uint32_t BoardSize, typename Liberties = ExactLiberties>
+struct BasicPlayoutState
+{
+	using BoardState = BasicBoardState<BoardSize>;
+	static constexpr uint32_t BOARD_SIZE = BoardSize;
+
 	BoardState board_state;
-	ClusterTable cluster_table;
-	uint32_t board_size;
+	BasicClusterTable<BoardSize, Liberties> cluster_table;
 	uint32_t number_played_moves;
 	uint32_t player_turn;
 	std::array<Player, 2> players;
-	std::vector<Action> move_history;
+	BasicEmptyCells<BoardSize> empty_cells;
+	// clusters with a single liberty, kept up to date by update_clusters
+	BasicAtariClusters<BoardSize> atari_clusters;
+	// 3x3 pattern code of each cell, see pattern.h
+	BasicPatterns<BoardSize> patterns;
+	// cells where each player is allowed to play, ignoring superko
+	std::array<BasicBitboard<BoardSize>, 2> legal_moves;
+	// zobrist hash of the current position, see zobrist.h
+	uint64_t hash;
+	// number of passes played in a row, the game ends at two
+	uint32_t consecutive_passes;
 
-	GameState()
-	    : board_state(), board_size{BoardState::MAX_BOARD_SIZE},
-	      number_played_moves{0}, player_turn{0}
+	BasicPlayoutState()
+	    : board_state(), number_played_moves{0}, player_turn{0}, hash{0},
+	      consecutive_passes{0}
 	{
+		// every empty cell is legal on an empty board
+		for (uint32_t i = 0; i < empty_cells.size; i++)
+		{
+			legal_moves[0].set(empty_cells.cells[i]);
+			legal_moves[1].set(empty_cells.cells[i]);
+		}
 	}
 };
 
+using PlayoutState = BasicPlayoutState<DEFAULT_BOARD_SIZE>;
+
+static_assert(std::is_trivially_copyable_v<PlayoutState>);
+static_assert(std::is_trivially_copyable_v<
+              BasicPlayoutState<DEFAULT_BOARD_SIZE, PseudoLiberties>>);
+
+// A playout state with the history of the game, slicing it to its
+// BasicPlayoutState base gives the state to start a playout from
+template <uint32_t BoardSize, typename Liberties = ExactLiberties>
+struct BasicGameState : BasicPlayoutState<BoardSize, Liberties>
+{
+	// past this many moves, only passes are valid so that the game ends
+	static constexpr uint32_t MAX_NUM_MOVES =
+	    BasicBoardState<BoardSize>::MAX_NUM_MOVES;
+	static constexpr uint32_t HISTORY_CAPACITY = MAX_NUM_MOVES + 2;
+
+	MoveHistory<HISTORY_CAPACITY> move_history;
+	// hashes of the positions before each move in move_history
+	HashHistory<HISTORY_CAPACITY> hash_history;
+	// forbids moves that recreate any previous position
+	bool positional_superko;
+	// records of the last moves in move_history, used by unmake_move
+	BasicJournal<BoardSize> journal;
+
+	BasicGameState() : positional_superko{false}
+	{
+	}
+};
+
+using GameState = BasicGameState<DEFAULT_BOARD_SIZE>;
+
+static_assert(std::is_trivially_copyable_v<GameState>);
+
 // TODO: Support more rules and make it runtime!
 struct Rules
 {
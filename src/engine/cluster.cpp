@@ -7,42 +7,171 @@
 
 using namespace go::engine;
 
+template <uint32_t BoardSize>
+using ExactClusterTable = BasicClusterTable<BoardSize, ExactLiberties>;
+template <uint32_t BoardSize>
+using PseudoClusterTable = BasicClusterTable<BoardSize, PseudoLiberties>;
+
+template <uint32_t BoardSize, typename Liberties>
+static void init_single_cell_cluster(
+    Cluster&, BasicClusterTable<BoardSize, Liberties>&,
+    const BasicBoardState<BoardSize>&, const Action&);
+template <uint32_t BoardSize, typename Liberties>
+static Cluster* merge_clusters(
+    Cluster**, uint32_t, BasicClusterTable<BoardSize, Liberties>&);
+template <uint32_t BoardSize, typename Liberties>
+static void merge_cluster_with_cell(
+    Cluster&, uint32_t, BasicClusterTable<BoardSize, Liberties>&,
+    const BasicBoardState<BoardSize>&);
+template <uint32_t BoardSize, typename Liberties>
+static void capture_cluster(
+    Cluster&, BasicPlayoutState<BoardSize, Liberties>&, MoveRecord&,
+    CapturedStones<BoardSize>&);
+template <uint32_t BoardSize, typename Liberties>
+static void rebuild_cluster(
+    BasicClusterTable<BoardSize, Liberties>&,
+    const BasicBoardState<BoardSize>&, uint32_t);
+template <uint32_t BoardSize, typename Liberties>
+static void recount_liberties(
+    BasicClusterTable<BoardSize, Liberties>&,
+    const BasicBoardState<BoardSize>&, Cluster&);
+template <uint32_t BoardSize, typename Liberties>
+static void update_legal_moves_around(
+    BasicPlayoutState<BoardSize, Liberties>&, const MoveRecord&,
+    const CapturedStones<BoardSize>&);
+template <uint32_t BoardSize, typename Liberties>
+static void
+update_atari_clusters(BasicPlayoutState<BoardSize, Liberties>&, const Cluster&);
+template <uint32_t BoardSize, typename Liberties>
+static void
+leave_atari(BasicPlayoutState<BoardSize, Liberties>&, const Cluster&);
+
+// Liberty primitives, one overload per liberty model. add_liberty and
+// remove_liberty are called once per stone next to the liberty, exact
+// liberties ignore the repeated calls.
+
+template <uint32_t BoardSize>
 static void
-init_single_cell_cluster(Cluster&, const BoardState&, const Action&);
-static Cluster* merge_clusters(Cluster**, uint32_t);
+acquire_liberties(ExactClusterTable<BoardSize>& table, Cluster& cluster)
+{
+	assert(table.num_free_liberties > 0);
+	cluster.liberties_idx = table.free_liberties[--table.num_free_liberties];
+}
+
+template <uint32_t BoardSize>
+static void acquire_liberties(PseudoClusterTable<BoardSize>&, Cluster&)
+{
+}
+
+template <uint32_t BoardSize>
 static void
-merge_cluster_with_cell(Cluster&, uint32_t, ClusterTable&, const BoardState&);
-static void capture_cluster(Cluster&, GameState&);
+release_liberties(ExactClusterTable<BoardSize>& table, const Cluster& cluster)
+{
+	assert(
+	    table.num_free_liberties <
+	    ExactClusterTable<BoardSize>::MAX_NUM_CLUSTERS);
+	table.free_liberties[table.num_free_liberties++] = cluster.liberties_idx;
+}
 
-uint32_t
-go::engine::get_cluster_idx(const ClusterTable& table, uint32_t cell_idx)
+template <uint32_t BoardSize>
+static void release_liberties(PseudoClusterTable<BoardSize>&, const Cluster&)
 {
-	uint32_t idx_crawler = cell_idx;
-	while (table.clusters[idx_crawler].parent_idx != idx_crawler)
-		idx_crawler = table.clusters[idx_crawler].parent_idx;
+}
 
-	// lazy update
-	table.clusters[cell_idx].parent_idx = idx_crawler;
-	return idx_crawler;
+template <uint32_t BoardSize>
+static void
+clear_liberties(ExactClusterTable<BoardSize>& table, Cluster& cluster)
+{
+	get_liberties_map(table, cluster).reset();
+	cluster.num_liberties = 0;
 }
 
-Cluster& go::engine::get_cluster(ClusterTable& table, uint32_t cell_idx)
+template <uint32_t BoardSize>
+static void
+clear_liberties(PseudoClusterTable<BoardSize>& table, Cluster& cluster)
 {
-	return table.clusters[get_cluster_idx(table, cell_idx)];
+	table.liberty_sums[cluster.parent_idx] = 0;
+	table.liberty_square_sums[cluster.parent_idx] = 0;
+	cluster.num_liberties = 0;
+}
+
+template <uint32_t BoardSize>
+static void add_liberty(
+    ExactClusterTable<BoardSize>& table, Cluster& cluster, uint32_t cell_idx)
+{
+	auto& liberties_map = get_liberties_map(table, cluster);
+	if (!liberties_map.test(cell_idx))
+	{
+		liberties_map.set(cell_idx);
+		cluster.num_liberties++;
+	}
 }
 
-const Cluster&
-go::engine::get_cluster(const ClusterTable& table, uint32_t cell_idx)
+template <uint32_t BoardSize>
+static void add_liberty(
+    PseudoClusterTable<BoardSize>& table, Cluster& cluster, uint32_t cell_idx)
 {
-	return table.clusters[get_cluster_idx(table, cell_idx)];
+	table.liberty_sums[cluster.parent_idx] += cell_idx;
+	table.liberty_square_sums[cluster.parent_idx] += cell_idx * cell_idx;
+	cluster.num_liberties++;
 }
 
-void go::engine::update_clusters(GameState& game_state, const Action& action)
+template <uint32_t BoardSize>
+static void remove_liberty(
+    ExactClusterTable<BoardSize>& table, Cluster& cluster, uint32_t cell_idx)
+{
+	auto& liberties_map = get_liberties_map(table, cluster);
+	if (liberties_map.test(cell_idx))
+	{
+		liberties_map.reset(cell_idx);
+		cluster.num_liberties--;
+	}
+}
+
+template <uint32_t BoardSize>
+static void remove_liberty(
+    PseudoClusterTable<BoardSize>& table, Cluster& cluster, uint32_t cell_idx)
+{
+	table.liberty_sums[cluster.parent_idx] -= cell_idx;
+	table.liberty_square_sums[cluster.parent_idx] -= cell_idx * cell_idx;
+	cluster.num_liberties--;
+}
+
+// gives the liberties of from to into, before from's stones are relabeled
+template <uint32_t BoardSize>
+static void merge_liberties(
+    ExactClusterTable<BoardSize>& table, Cluster& into, const Cluster& from)
+{
+	auto& liberties_map = get_liberties_map(table, into);
+	liberties_map |= get_liberties_map(table, from);
+	into.num_liberties = uint16_t(liberties_map.count());
+	release_liberties(table, from);
+}
+
+template <uint32_t BoardSize>
+static void merge_liberties(
+    PseudoClusterTable<BoardSize>& table, Cluster& into, const Cluster& from)
+{
+	table.liberty_sums[into.parent_idx] += table.liberty_sums[from.parent_idx];
+	table.liberty_square_sums[into.parent_idx] +=
+	    table.liberty_square_sums[from.parent_idx];
+	into.num_liberties = uint16_t(into.num_liberties + from.num_liberties);
+}
+
+template <uint32_t BoardSize, typename Liberties>
+void go::engine::update_clusters(
+    BasicPlayoutState<BoardSize, Liberties>& game_state, const Action& action,
+    MoveRecord& record, CapturedStones<BoardSize>& captured_stones)
 {
 	auto& table = game_state.cluster_table;
 	auto& board_state = game_state.board_state;
-	// obtain a list of neighbor clusters, and update liberties
-	// of enemy clusters
+	// the neighbor clusters lose the liberty taken by the stone
+	for_each_neighbor(board_state, action.pos, [&](uint32_t neighbor) {
+		if (!is_empty_cell(board_state, neighbor))
+			remove_liberty(table, get_cluster(table, neighbor), action.pos);
+	});
+
+	// obtain a list of neighbor clusters
 	Cluster* to_merge[4];
 	Cluster* to_capture[4];
 	uint32_t merge_count = 0;
@@ -50,8 +179,6 @@ void go::engine::update_clusters(GameState& game_state, const Action& action)
 
 	for_each_neighbor_cluster(
 	    table, board_state, action.pos, [&](auto& cluster) {
-		    cluster.liberties_map.set(action.pos, false);
-		    cluster.num_liberties--;
 		    // if friendly cluster, add it to be merged
 		    if (cluster.player == action.player_index)
 			    to_merge[merge_count++] = &cluster;
@@ -60,58 +187,130 @@ void go::engine::update_clusters(GameState& game_state, const Action& action)
 			    to_capture[capture_count++] = &cluster;
 	    });
 
+	for (uint32_t i = 0; i < merge_count; i++)
+	{
+		record.merged_roots[i] = uint16_t(to_merge[i]->parent_idx);
+		// added back with the root of the merged cluster if still in atari
+		leave_atari(game_state, *to_merge[i]);
+	}
+	record.merged_count = uint8_t(merge_count);
+
 	Cluster& action_cluster = table.clusters[action.pos];
 	if (merge_count == 0)
 	{
-		init_single_cell_cluster(action_cluster, board_state, action);
+		init_single_cell_cluster(action_cluster, table, board_state, action);
 	}
 	else
 	{
-		Cluster& mega_cluster = *merge_clusters(to_merge, merge_count);
+		Cluster& mega_cluster = *merge_clusters(to_merge, merge_count, table);
 		merge_cluster_with_cell(mega_cluster, action.pos, table, board_state);
 	}
 	// now cleanup dead clusters
 	for (auto it = to_capture; it != to_capture + capture_count; it++)
-		capture_cluster(**it, game_state);
+		capture_cluster(**it, game_state, record, captured_stones);
+
+	// the played stone's cluster and the enemy clusters around it have new
+	// liberty counts
+	update_atari_clusters(game_state, get_cluster(table, action.pos));
+	for_each_neighbor_cluster(
+	    table, board_state, action.pos, [&](const Cluster& cluster) {
+		    if (cluster.player != action.player_index)
+			    update_atari_clusters(game_state, cluster);
+	    });
+	update_legal_moves_around(game_state, record, captured_stones);
 }
 
+template <uint32_t BoardSize, typename Liberties>
+void go::engine::restore_clusters(
+    BasicPlayoutState<BoardSize, Liberties>& game_state,
+    const MoveRecord& record, const CapturedStones<BoardSize>& captured_stones)
+{
+	auto& table = game_state.cluster_table;
+	auto& board_state = game_state.board_state;
+	const uint32_t action_pos = record.pos;
+	const uint32_t player = record.player_index;
+
+	// the cluster of the played stone goes away, the clusters it was made
+	// of get their own liberties back when rebuilt
+	release_liberties(table, get_cluster(table, action_pos));
+	leave_atari(game_state, get_cluster(table, action_pos));
+
+	// put the board back as it was before the move
+	remove_stone(game_state, action_pos);
+	for (uint32_t i = record.captured_begin; i < captured_stones.size(); i++)
+		place_stone(game_state, captured_stones[i], 1 - player);
+
+	// clusters merged or captured by the move are recomputed from the board
+	for (uint32_t i = 0; i < record.merged_count; i++)
+		rebuild_cluster(table, board_state, record.merged_roots[i]);
+	for (uint32_t i = 0; i < record.captured_count; i++)
+		rebuild_cluster(table, board_state, record.captured_roots[i]);
+
+	// the liberties of the clusters next to the changed cells are counted
+	// again, this includes the rebuilt clusters
+	{
+		LocalSearchCache<BoardSize> local_cache;
+		auto& recounted = *local_cache;
+		auto recount_around = [&](uint32_t cell_idx) {
+			for_each_neighbor_cluster(
+			    table, board_state, cell_idx, [&](Cluster& cluster) {
+				    if (recounted.is_visited(cluster.parent_idx))
+					    return;
+				    recounted.mark_visited(cluster.parent_idx);
+				    recount_liberties(table, board_state, cluster);
+				    update_atari_clusters(game_state, cluster);
+			    });
+		};
+		recount_around(action_pos);
+		for (uint32_t i = record.captured_begin; i < captured_stones.size();
+		     i++)
+			recount_around(captured_stones[i]);
+	}
+
+	update_legal_moves_around(game_state, record, captured_stones);
+}
+
+template <uint32_t BoardSize, typename Liberties>
 static void init_single_cell_cluster(
-    Cluster& cluster, const BoardState& state, const Action& action)
+    Cluster& cluster, BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>& state, const Action& action)
 {
-	cluster.player = action.player_index;
-	cluster.parent_idx = action.pos;
+	cluster.player = uint8_t(action.player_index);
+	cluster.parent_idx = uint16_t(action.pos);
+	table.next_stone[action.pos] = uint16_t(action.pos);
 	cluster.size = 1;
-	cluster.liberties_map.reset();
-	cluster.num_liberties = 0;
+	acquire_liberties(table, cluster);
+	clear_liberties(table, cluster);
 	for_each_neighbor(state, action.pos, [&](uint32_t neighbor) {
 		if (is_empty_cell(state, neighbor))
-		{
-			cluster.liberties_map.set(neighbor, true);
-			cluster.num_liberties++;
-		}
+			add_liberty(table, cluster, neighbor);
 	});
 }
 
+template <uint32_t BoardSize, typename Liberties>
 static void merge_cluster_with_cell(
-    Cluster& cluster, uint32_t cell_index, ClusterTable& table,
-    const BoardState& state)
+    Cluster& cluster, uint32_t cell_index,
+    BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>& state)
 {
 	Cluster& cell_cluster = table.clusters[cell_index];
 	cell_cluster.parent_idx = cluster.parent_idx;
-	// add the effects of the single cell cluster:
-	//     1. Remove the liberty where it's played
-	//     2. Add its own liberties
+	// insert the cell after the root in the stones list
+	table.next_stone[cell_index] = table.next_stone[cluster.parent_idx];
+	table.next_stone[cluster.parent_idx] = uint16_t(cell_index);
+	// the liberty where the cell is played is already removed, add its own
+	// liberties
 	for_each_neighbor(state, cell_index, [&](uint32_t neighbor) {
 		if (is_empty_cell(state, neighbor))
-			cluster.liberties_map.set(neighbor, true);
+			add_liberty(table, cluster, neighbor);
 	});
-	cluster.liberties_map.set(cell_index, false);
-
-	cluster.num_liberties = cluster.liberties_map.count();
 	cluster.size++;
 }
 
-static Cluster* merge_clusters(Cluster* clusters[], uint32_t count)
+template <uint32_t BoardSize, typename Liberties>
+static Cluster* merge_clusters(
+    Cluster* clusters[], uint32_t count,
+    BasicClusterTable<BoardSize, Liberties>& table)
 {
 	assert(count >= 1);
 	if (count == 1)
@@ -127,17 +326,32 @@ static Cluster* merge_clusters(Cluster* clusters[], uint32_t count)
 	for (auto it = clusters + 1; it != clusters + count; it++)
 	{
 		Cluster* to_merge = *it;
-		biggest->size += to_merge->size;
-		to_merge->parent_idx = biggest->parent_idx;
-		biggest->liberties_map |= to_merge->liberties_map;
+		const uint32_t merged_root = to_merge->parent_idx;
+		merge_liberties(table, *biggest, *to_merge);
+		// relabel the stones of the smaller cluster, so that every stone
+		// keeps pointing to its root
+		for_each_cluster_cell(table, *to_merge, [&](uint32_t cell_idx) {
+			table.clusters[cell_idx].parent_idx = biggest->parent_idx;
+		});
+		biggest->size = uint16_t(biggest->size + to_merge->size);
+		// swapping the successors of two stones from different lists joins
+		// the lists
+		std::swap(
+		    table.next_stone[biggest->parent_idx],
+		    table.next_stone[merged_root]);
 	}
 	return biggest;
 }
 
-static void capture_cluster(Cluster& cluster, GameState& game_state)
+template <uint32_t BoardSize, typename Liberties>
+static void capture_cluster(
+    Cluster& cluster, BasicPlayoutState<BoardSize, Liberties>& game_state,
+    MoveRecord& record, CapturedStones<BoardSize>& captured_stones)
 {
 	auto& board_state = game_state.board_state;
 	auto& table = game_state.cluster_table;
+	record.captured_roots[record.captured_count++] =
+	    uint16_t(cluster.parent_idx);
 
 	// update player info
 	auto captured_player_idx = cluster.player;
@@ -145,17 +359,142 @@ static void capture_cluster(Cluster& cluster, GameState& game_state)
 	captured_player.number_alive_stones -= cluster.size;
 	auto& other_player = game_state.players[1 - captured_player_idx];
 	other_player.number_captured_enemies += cluster.size;
+	release_liberties(table, cluster);
+	leave_atari(game_state, cluster);
+
+	// the neighbor stones that aren't in the cluster belong to the capturing
+	// player, and their clusters gain the captured cells as liberties
+	const Cell capturing_stone = PLAYERS[1 - captured_player_idx];
+	for_each_cluster_cell(table, cluster, [&](uint32_t cell_idx) {
+		for_each_neighbor(board_state, cell_idx, [&](uint32_t neighbor) {
+			if (board_state.board[neighbor] == capturing_stone)
+			{
+				Cluster& neighbor_cluster = get_cluster(table, neighbor);
+				add_liberty(table, neighbor_cluster, cell_idx);
+				update_atari_clusters(game_state, neighbor_cluster);
+			}
+		});
+		remove_stone(game_state, cell_idx);
+		captured_stones.push_back(uint16_t(cell_idx));
+	});
+}
+
+// Recomputes the structure of the cluster at root from the board, its
+// liberties are left to recount_liberties
+template <uint32_t BoardSize, typename Liberties>
+static void rebuild_cluster(
+    BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>& state, uint32_t root)
+{
+	Cluster& cluster = table.clusters[root];
+	cluster.parent_idx = uint16_t(root);
+	cluster.player = uint8_t(get_player_index(state.board[root]));
+	cluster.size = 0;
+	table.next_stone[root] = uint16_t(root);
+	acquire_liberties(table, cluster);
+	for_each_cluster_cell(cluster, state, [&](uint32_t cell_idx) {
+		table.clusters[cell_idx].parent_idx = uint16_t(root);
+		if (cell_idx != root)
+		{
+			table.next_stone[cell_idx] = table.next_stone[root];
+			table.next_stone[root] = uint16_t(cell_idx);
+		}
+		cluster.size++;
+	});
+}
+
+template <uint32_t BoardSize, typename Liberties>
+static void recount_liberties(
+    BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>& state, Cluster& cluster)
+{
+	clear_liberties(table, cluster);
+	for_each_cluster_cell(table, cluster, [&](uint32_t cell_idx) {
+		for_each_neighbor(state, cell_idx, [&](uint32_t neighbor) {
+			if (is_empty_cell(state, neighbor))
+				add_liberty(table, cluster, neighbor);
+		});
+	});
+}
 
-	for_each_cluster_cell(cluster, board_state, [&](uint32_t cell_idx) {
-		for_each_neighbor_cluster(
-		    table, board_state, cell_idx, [&](Cluster& neighbor) {
-			    if (&neighbor != &cluster)
-			    {
-				    neighbor.liberties_map.set(cell_idx, true);
-				    neighbor.num_liberties++;
-			    }
-		    });
-		board_state.board[cell_idx] = Cell::EMPTY;
+// Adds the cluster to the atari list or removes it from there, the patterns
+// around its stones are flagged while it is in the list
+template <uint32_t BoardSize, typename Liberties>
+static void update_atari_clusters(
+    BasicPlayoutState<BoardSize, Liberties>& game_state, const Cluster& cluster)
+{
+	const auto& table = game_state.cluster_table;
+	auto& atari_clusters = game_state.atari_clusters;
+	if (!is_in_atari(table, cluster))
+	{
+		leave_atari(game_state, cluster);
+		return;
+	}
+	if (!atari_clusters.contains(cluster.parent_idx))
+	{
+		for_each_cluster_cell(table, cluster, [&](uint32_t cell_idx) {
+			game_state.patterns.add_atari(cell_idx);
+		});
+	}
+	atari_clusters.insert(
+	    cluster.parent_idx, get_atari_liberty(table, cluster));
+}
+
+template <uint32_t BoardSize, typename Liberties>
+static void leave_atari(
+    BasicPlayoutState<BoardSize, Liberties>& game_state, const Cluster& cluster)
+{
+	if (!game_state.atari_clusters.contains(cluster.parent_idx))
+		return;
+	for_each_cluster_cell(
+	    game_state.cluster_table, cluster, [&](uint32_t cell_idx) {
+		    game_state.patterns.remove_atari(cell_idx);
+	    });
+	game_state.atari_clusters.remove(cluster.parent_idx);
+}
+
+// A cell's legality depends on the cell, the ko point, its neighbors and the
+// liberty count of their clusters. So after a move, only the changed cells,
+// their neighbors, the liberties of the clusters next to them and the previous
+// ko point need to be checked again. The new ko point is a captured stone.
+template <uint32_t BoardSize, typename Liberties>
+static void update_legal_moves_around(
+    BasicPlayoutState<BoardSize, Liberties>& game_state,
+    const MoveRecord& record, const CapturedStones<BoardSize>& captured_stones)
+{
+	const auto& table = game_state.cluster_table;
+	const auto& board_state = game_state.board_state;
+
+	BasicBitboard<BoardSize> to_update;
+	// clusters whose liberties are already marked
+	LocalSearchCache<BoardSize> local_cache;
+	auto& marked = *local_cache;
+	auto mark_around = [&](uint32_t cell_idx) {
+		to_update.set(cell_idx);
+		for_each_neighbor(board_state, cell_idx, [&](uint32_t neighbor) {
+			if (is_empty_cell(board_state, neighbor))
+			{
+				to_update.set(neighbor);
+				return;
+			}
+			const Cluster& cluster = get_cluster(table, neighbor);
+			if (!marked.is_visited(cluster.parent_idx))
+			{
+				marked.mark_visited(cluster.parent_idx);
+				// the legality of the liberties depends on the cluster
+				mark_liberties(to_update, table, board_state, cluster);
+			}
+		});
+	};
+
+	mark_around(record.pos);
+	for (uint32_t i = record.captured_begin; i < captured_stones.size(); i++)
+		mark_around(captured_stones[i]);
+	if (record.ko != BasicBoardState<BoardSize>::INVALID_INDEX)
+		to_update.set(record.ko);
+
+	for_each_cell(to_update, [&](uint32_t cell_idx) {
+		update_legal_moves(game_state, cell_idx);
 	});
 }
 
@@ -163,3 +502,34 @@ uint32_t go::engine::get_num_liberties(const Cluster& cluster)
 {
 	return cluster.num_liberties;
 }
+
+template <uint32_t BoardSize>
+BasicLibertiesMap<BoardSize>& go::engine::get_liberties_map(
+    ExactClusterTable<BoardSize>& table, const Cluster& cluster)
+{
+	return table.liberties[cluster.liberties_idx];
+}
+
+template <uint32_t BoardSize>
+const BasicLibertiesMap<BoardSize>& go::engine::get_liberties_map(
+    const ExactClusterTable<BoardSize>& table, const Cluster& cluster)
+{
+	return table.liberties[cluster.liberties_idx];
+}
+
+#define INSTANTIATE_LIBERTIES_MAP(N)                                           \
+	template BasicLibertiesMap<N>& go::engine::get_liberties_map(              \
+	    ExactClusterTable<N>&, const Cluster&);                                \
+	template const BasicLibertiesMap<N>& go::engine::get_liberties_map(        \
+	    const ExactClusterTable<N>&, const Cluster&);
+
+#define INSTANTIATE_CLUSTER(N, L)                                              \
+	template void go::engine::update_clusters(                                 \
+	    BasicPlayoutState<N, L>&, const Action&, MoveRecord&,                  \
+	    CapturedStones<N>&);                                                   \
+	template void go::engine::restore_clusters(                                \
+	    BasicPlayoutState<N, L>&, const MoveRecord&,                           \
+	    const CapturedStones<N>&);
+
+FOR_EACH_BOARD_SIZE(INSTANTIATE_LIBERTIES_MAP)
+FOR_EACH_LIBERTY_MODEL(INSTANTIATE_CLUSTER)
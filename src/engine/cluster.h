@@ -9,12 +9,91 @@ namespace engine
 {
 
 uint32_t get_num_liberties(const Cluster&);
-uint32_t get_cluster_idx(const ClusterTable& table, uint32_t cell_idx);
-Cluster& get_cluster(ClusterTable& table, uint32_t cell_idx);
-const Cluster& get_cluster(const ClusterTable& table, uint32_t cell_idx);
+// Only exact liberties keep a map of the liberties of each cluster
+template <uint32_t BoardSize>
+BasicLibertiesMap<BoardSize>& get_liberties_map(
+    BasicClusterTable<BoardSize, ExactLiberties>& table, const Cluster&);
+template <uint32_t BoardSize>
+const BasicLibertiesMap<BoardSize>& get_liberties_map(
+    const BasicClusterTable<BoardSize, ExactLiberties>& table, const Cluster&);
 
-// Updates cluster information given an action.
-void update_clusters(GameState&, const Action&);
+// Merges relabel the stones of the smaller cluster, so every stone points to
+// its root and a lookup is a single read
+template <uint32_t BoardSize, typename Liberties>
+inline uint32_t get_cluster_idx(
+    const BasicClusterTable<BoardSize, Liberties>& table, uint32_t cell_idx)
+{
+	uint32_t root = table.clusters[cell_idx].parent_idx;
+	assert(table.clusters[root].parent_idx == root);
+	return root;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+inline Cluster& get_cluster(
+    BasicClusterTable<BoardSize, Liberties>& table, uint32_t cell_idx)
+{
+	return table.clusters[get_cluster_idx(table, cell_idx)];
+}
+
+template <uint32_t BoardSize, typename Liberties>
+inline const Cluster& get_cluster(
+    const BasicClusterTable<BoardSize, Liberties>& table, uint32_t cell_idx)
+{
+	return table.clusters[get_cluster_idx(table, cell_idx)];
+}
+
+// Whether the cluster has a single liberty
+template <uint32_t BoardSize>
+inline bool is_in_atari(
+    const BasicClusterTable<BoardSize, ExactLiberties>&, const Cluster& cluster)
+{
+	return cluster.num_liberties == 1;
+}
+
+// The pseudo liberties are all the same cell iff the square of their sum is
+// their number times the sum of their squares (Cauchy-Schwarz)
+template <uint32_t BoardSize>
+inline bool is_in_atari(
+    const BasicClusterTable<BoardSize, PseudoLiberties>& table,
+    const Cluster& cluster)
+{
+	uint64_t sum = table.liberty_sums[cluster.parent_idx];
+	uint64_t square_sum = table.liberty_square_sums[cluster.parent_idx];
+	return cluster.num_liberties > 0 &&
+	       sum * sum == cluster.num_liberties * square_sum;
+}
+
+// The only liberty of a cluster in atari
+template <uint32_t BoardSize>
+inline uint32_t get_atari_liberty(
+    const BasicClusterTable<BoardSize, ExactLiberties>& table,
+    const Cluster& cluster)
+{
+	assert(is_in_atari(table, cluster));
+	return get_liberties_map(table, cluster).first();
+}
+
+template <uint32_t BoardSize>
+inline uint32_t get_atari_liberty(
+    const BasicClusterTable<BoardSize, PseudoLiberties>& table,
+    const Cluster& cluster)
+{
+	assert(is_in_atari(table, cluster));
+	return table.liberty_sums[cluster.parent_idx] / cluster.num_liberties;
+}
+
+// Updates cluster information given an action, and fills the parts of the
+// move record related to clusters. The captured stones are appended to
+// captured_stones.
+template <uint32_t BoardSize, typename Liberties>
+void update_clusters(
+    BasicPlayoutState<BoardSize, Liberties>&, const Action&, MoveRecord&,
+    CapturedStones<BoardSize>& captured_stones);
+// Reverts the changes of update_clusters using the move record.
+template <uint32_t BoardSize, typename Liberties>
+void restore_clusters(
+    BasicPlayoutState<BoardSize, Liberties>&, const MoveRecord&,
+    const CapturedStones<BoardSize>& captured_stones);
 
 } // namespace engine
 } // namespace go
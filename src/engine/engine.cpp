@@ -2,20 +2,25 @@
 #include "interface.h"
 #include "liberties.h"
 #include "utility.h"
+#include "zobrist.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace go::engine;
 
+template <uint32_t BoardSize>
 static inline uint32_t territory_points(
-    const BoardState&, unsigned char&, uint32_t, details::SearchCache&);
+    const BasicBoardState<BoardSize>&, unsigned char&, uint32_t,
+    details::SearchCache<BoardSize>&);
 
+template <uint32_t BoardSize, typename Liberties>
 bool go::engine::is_valid_move(
-    const ClusterTable& table, const BoardState& board_state,
-    const Action& action)
+    const BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>& board_state, const Action& action)
 {
 	if (is_pass(action))
 		return true;
-	else if (is_invalid(action))
+	else if (is_invalid<BoardSize>(action))
 		return false;
 	else if (!is_empty_cell(board_state, action.pos))
 		return false;
@@ -27,15 +32,71 @@ bool go::engine::is_valid_move(
 		return true;
 }
 
-bool go::engine::is_suicide_move(
-    const ClusterTable& table, const BoardState& board_state,
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_valid_move(
+    const BasicPlayoutState<BoardSize, Liberties>& state, const Action& action)
+{
+	if (is_pass(action))
+		return true;
+	else if (is_invalid<BoardSize>(action))
+		return false;
+	else if (!state.legal_moves[action.player_index].test(action.pos))
+		return false;
+	else
+		return true;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_valid_move(
+    const BasicGameState<BoardSize, Liberties>& game_state,
     const Action& action)
+{
+	using State = BasicGameState<BoardSize, Liberties>;
+	const BasicPlayoutState<BoardSize, Liberties>& playout_state = game_state;
+	// the history ends with the two passes after MAX_NUM_MOVES, the game is
+	// over by then
+	if (game_state.move_history.full())
+		return false;
+	else if (
+	    game_state.move_history.size >= State::MAX_NUM_MOVES &&
+	    !is_pass(action))
+		return false;
+	else if (!is_valid_move(playout_state, action))
+		return false;
+	else if (game_state.positional_superko && is_superko(game_state, action))
+		return false;
+	else
+		return true;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+void go::engine::update_legal_moves(
+    BasicPlayoutState<BoardSize, Liberties>& game_state, uint32_t cell_idx)
+{
+	const auto& table = game_state.cluster_table;
+	const auto& board_state = game_state.board_state;
+	for (uint32_t player = 0; player < 2; player++)
+	{
+		Action action = {cell_idx, player};
+		if (is_valid_move(table, board_state, action))
+			game_state.legal_moves[player].set(cell_idx);
+		else
+			game_state.legal_moves[player].reset(cell_idx);
+	}
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_suicide_move(
+    const BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>& board_state, const Action& action)
 {
 	bool is_suicide = true;
 	// move is not suicide if:
 	//     1. a neighbor cell is empty, or
 	//     2. a neighbor friend cluster has more than one liberty, or
 	//     3. a neighbor enemy cluster will be captured
+	// the neighbor clusters have the cell as a liberty, so they have more
+	// than one unless they are in atari
 	for_each_neighbor(board_state, action.pos, [&](uint32_t neighbor) {
 		if (is_empty_cell(board_state, neighbor))
 		{
@@ -44,7 +105,7 @@ bool go::engine::is_suicide_move(
 		}
 		else if (board_state.board[neighbor] == PLAYERS[action.player_index])
 		{
-			if (get_cluster(table, neighbor).num_liberties > 1)
+			if (!is_in_atari(table, get_cluster(table, neighbor)))
 			{
 				is_suicide = false;
 				return BREAK;
@@ -54,7 +115,7 @@ bool go::engine::is_suicide_move(
 		else
 		{
 			// if an enemy cluster will be captured
-			if (get_cluster(table, neighbor).num_liberties == 1)
+			if (is_in_atari(table, get_cluster(table, neighbor)))
 			{
 				is_suicide = false;
 				return BREAK;
@@ -65,49 +126,113 @@ bool go::engine::is_suicide_move(
 	return is_suicide;
 }
 
-static uint32_t
-get_ko(const ClusterTable& table, const BoardState& state, uint32_t action_pos)
+template <uint32_t BoardSize, typename Liberties>
+static uint32_t get_ko(
+    const BasicPlayoutState<BoardSize, Liberties>& game_state,
+    uint32_t action_pos)
 {
-	if (count_liberties(table, action_pos) != 1)
+	const auto& table = game_state.cluster_table;
+	const auto& state = game_state.board_state;
+	// The played stone is on the board, but its cluster isn't built yet, and
+	// the atari clusters are the ones before the move.
+	// there is a ko if:
+	//     1. the played stone has no empty or friend neighbor, so it ends up
+	//        alone with the captured cell as its only liberty, and
+	//     2. the move captures exactly one stone
+	const Cell stone = state.board[action_pos];
+	bool can_be_ko = true;
+	for_each_neighbor(state, action_pos, [&](uint32_t neighbor) {
+		if (is_empty_cell(state.board[neighbor]) ||
+		    state.board[neighbor] == stone)
+		{
+			can_be_ko = false;
+			return BREAK;
+		}
+		return CONTINUE;
+	});
+	if (!can_be_ko)
 		return BoardState::INVALID_INDEX;
 
 	uint32_t num_captured_stones = 0;
-	uint32_t captured_stone_idx;
+	uint32_t captured_stone_idx = BoardState::INVALID_INDEX;
 	for_each_neighbor_cluster(table, state, action_pos, [&](auto& cluster) {
-		if (cluster.num_liberties == 1)
+		// an enemy cluster in atari next to the stone had its liberty there
+		if (game_state.atari_clusters.contains(cluster.parent_idx))
 		{
 			num_captured_stones += cluster.size;
 			captured_stone_idx = cluster.parent_idx;
 		}
 	});
 
-	// there is a ko if:
-	//     1. the previous move captured exactly one stone,
-	//     2. the played stone has exactly one liberty, and
-	//     3. the played stone's cluster consists only of it
-	if (get_cluster(table, action_pos).size == 1 && num_captured_stones == 1)
+	if (num_captured_stones == 1)
 		return captured_stone_idx;
 	else
 		return BoardState::INVALID_INDEX;
 }
 
-bool go::engine::make_move(GameState& game_state, const Action& action)
+// Plays the legal action and fills its record, the part of make_move shared
+// by game states and playout states
+template <uint32_t BoardSize, typename Liberties>
+static void play_move(
+    BasicPlayoutState<BoardSize, Liberties>& state, const Action& action,
+    MoveRecord& record, CapturedStones<BoardSize>& captured_stones)
 {
-	ClusterTable& table = game_state.cluster_table;
-	BoardState& board_state = game_state.board_state;
-	if (is_valid_move(table, board_state, action))
+	auto& board_state = state.board_state;
+	record.pos = uint16_t(action.pos);
+	record.player_index = uint8_t(action.player_index);
+	record.ko = uint16_t(board_state.ko);
+	record.captured_begin = captured_stones.size();
+	record.consecutive_passes = uint16_t(state.consecutive_passes);
+
+	if (is_pass(action))
 	{
-		if (!is_pass(action))
-		{
-			game_state.players[game_state.player_turn].number_alive_stones++;
-			board_state.board[action.pos] = PLAYERS[action.player_index];
-			board_state.ko = get_ko(table, board_state, action.pos);
-			update_clusters(game_state, action);
-		}
+		state.consecutive_passes++;
+	}
+	else
+	{
+		state.consecutive_passes = 0;
+		state.players[state.player_turn].number_alive_stones++;
+		place_stone(state, action.pos, action.player_index);
+		board_state.ko = get_ko(state, action.pos);
+		update_clusters(state, action, record, captured_stones);
+	}
+
+	state.number_played_moves++;
+	state.player_turn = 1 - state.player_turn;
+}
 
-		game_state.number_played_moves++;
-		game_state.player_turn = 1 - game_state.player_turn;
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::make_move(
+    BasicGameState<BoardSize, Liberties>& game_state, const Action& action)
+{
+	auto& journal = game_state.journal;
+	if (is_valid_move(game_state, action))
+	{
+		MoveRecord record = {};
+		game_state.hash_history.push_back(game_state.hash);
+		play_move(game_state, action, record, journal.captured_stones);
 		game_state.move_history.push_back(action);
+		journal.push_back(record);
+
+		return true;
+	}
+	else
+	{
+		DEBUG_PRINT("engine::make_move: invalid move!\n");
+		return false;
+	}
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::make_move(
+    BasicPlayoutState<BoardSize, Liberties>& state, const Action& action)
+{
+	if (is_valid_move(state, action))
+	{
+		// the captured stones are only needed while the move is played
+		CapturedStones<BoardSize> captured_stones;
+		MoveRecord record = {};
+		play_move(state, action, record, captured_stones);
 
 		return true;
 	}
@@ -118,8 +243,44 @@ bool go::engine::make_move(GameState& game_state, const Action& action)
 	}
 }
 
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::unmake_move(BasicGameState<BoardSize, Liberties>& game_state)
+{
+	auto& journal = game_state.journal;
+	if (journal.empty())
+		return false;
+
+	const MoveRecord& record = journal.back();
+	game_state.player_turn = 1 - game_state.player_turn;
+	game_state.board_state.ko = record.ko;
+	game_state.consecutive_passes = record.consecutive_passes;
+	if (!is_pass(record.get_action()))
+	{
+		restore_clusters(game_state, record, journal.captured_stones);
+
+		const uint32_t num_captured =
+		    journal.captured_stones.size() - record.captured_begin;
+		auto& players = game_state.players;
+		const uint32_t player_idx = record.player_index;
+		players[game_state.player_turn].number_alive_stones--;
+		players[1 - player_idx].number_alive_stones += num_captured;
+		players[player_idx].number_captured_enemies -= num_captured;
+	}
+
+	assert(game_state.hash == game_state.hash_history.back());
+	game_state.hash_history.pop_back();
+	game_state.number_played_moves--;
+	game_state.move_history.pop_back();
+	journal.captured_stones.resize(record.captured_begin);
+	journal.pop_back();
+
+	return true;
+}
+
+template <uint32_t BoardSize>
 void go::engine::calculate_score(
-    const BoardState& boardState, Player& black_player, Player& white_player)
+    const BasicBoardState<BoardSize>& boardState, Player& black_player,
+    Player& white_player)
 {
 	uint32_t white_territory_score = 0, black_territory_score = 0,
 	         score_temp = 0;
@@ -128,12 +289,13 @@ void go::engine::calculate_score(
 	// white and "10" for black
 	unsigned char territory_type; // if the output of the traversed territory
 	                              // was "11" the it was a false territory
-	details::SearchCache
-	    search_cache; // to avoid starting traversing a new territory from an
-	                  // already traversed empty cell
+	// to avoid starting traversing a new territory from an already
+	// traversed empty cell
+	LocalSearchCache<BoardSize> local_cache;
+	auto& search_cache = *local_cache;
 
 	// Traversing the board to detect any start of any territory
-	for (uint32_t i = 0; i < BoardState::MAX_NUM_CELLS; i++)
+	for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS; i++)
 	{
 		if (!search_cache.is_visited(i) && is_empty_cell(boardState, i))
 		{
@@ -150,7 +312,15 @@ void go::engine::calculate_score(
 		}
 	}
 
-	// Updating scores
+	set_total_scores(
+	    black_territory_score, white_territory_score, black_player,
+	    white_player);
+}
+
+void go::engine::set_total_scores(
+    uint32_t black_territory_score, uint32_t white_territory_score,
+    Player& black_player, Player& white_player)
+{
 	white_player.total_score =
 	    white_territory_score + white_player.number_alive_stones +
 	    white_player.number_captured_enemies + Rules::KOMI;
@@ -159,9 +329,10 @@ void go::engine::calculate_score(
 	                           black_player.number_captured_enemies;
 }
 
+template <uint32_t BoardSize>
 static inline uint32_t territory_points(
-    const BoardState& state, unsigned char& territory_type, uint32_t root,
-    details::SearchCache& search_cache)
+    const BasicBoardState<BoardSize>& state, unsigned char& territory_type,
+    uint32_t root, details::SearchCache<BoardSize>& search_cache)
 {
 	uint32_t score = 1;
 	search_cache.push(root);
@@ -187,16 +358,190 @@ static inline uint32_t territory_points(
 	return score;
 }
 
-bool go::engine::is_terminal_state(const GameState& state)
+template <uint32_t BoardSize, typename Liberties>
+uint64_t go::engine::get_hash_after_move(
+    const BasicPlayoutState<BoardSize, Liberties>& game_state,
+    const Action& action)
+{
+	if (is_pass(action))
+		return game_state.hash;
+
+	const auto& table = game_state.cluster_table;
+	const auto& board_state = game_state.board_state;
+	uint64_t hash =
+	    game_state.hash ^ zobrist_key(action.player_index, action.pos);
+	// remove enemy clusters whose last liberty is taken by the action
+	for_each_neighbor_cluster(
+	    table, board_state, action.pos, [&](const Cluster& cluster) {
+		    if (cluster.player != action.player_index &&
+		        game_state.atari_clusters.contains(cluster.parent_idx))
+		    {
+			    for_each_cluster_cell(table, cluster, [&](uint32_t idx) {
+				    hash ^= zobrist_key(cluster.player, idx);
+			    });
+		    }
+	    });
+	return hash;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_superko(
+    const BasicGameState<BoardSize, Liberties>& game_state,
+    const Action& action)
 {
-	if (state.move_history.size() > 1)
+	// a pass keeps the position, any other legal move changes the board
+	if (is_pass(action))
+		return false;
+	return game_state.hash_history.contains(
+	    get_hash_after_move(game_state, action));
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_terminal_state(
+    const BasicPlayoutState<BoardSize, Liberties>& state)
+{
+	return state.consecutive_passes >= 2;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_terminal_state(
+    const BasicGameState<BoardSize, Liberties>& state)
+{
+	const BasicPlayoutState<BoardSize, Liberties>& playout_state = state;
+	return is_terminal_state(playout_state) || state.move_history.full();
+}
+
+template <uint32_t BoardSize, typename Liberties>
+MoveEffect go::engine::analyze_move(
+    const BasicPlayoutState<BoardSize, Liberties>& game_state,
+    const Action& action)
+{
+	MoveEffect effect = {};
+	effect.ko = BasicBoardState<BoardSize>::INVALID_INDEX;
+	if (is_pass(action))
+		return effect;
+
+	const auto& table = game_state.cluster_table;
+	const auto& board_state = game_state.board_state;
+	// the same neighbor scan as is_suicide_move and get_ko: the enemy
+	// clusters in atari are captured, the friend ones are merged
+	std::array<uint16_t, 4> merged_roots;
+	uint32_t merged_count = 0;
+	bool has_empty_neighbor = false;
+	BasicBitboard<BoardSize> liberties;
+	for_each_neighbor(board_state, action.pos, [&](uint32_t neighbor) {
+		if (is_empty_cell(board_state, neighbor))
+		{
+			has_empty_neighbor = true;
+			liberties.set(neighbor);
+		}
+	});
+	for_each_neighbor_cluster(
+	    table, board_state, action.pos, [&](const Cluster& cluster) {
+		    if (cluster.player == action.player_index)
+		    {
+			    merged_roots[merged_count++] = uint16_t(cluster.parent_idx);
+			    mark_liberties(liberties, table, board_state, cluster);
+		    }
+		    else if (game_state.atari_clusters.contains(cluster.parent_idx))
+		    {
+			    effect.captured_roots[effect.captured_count++] =
+			        uint16_t(cluster.parent_idx);
+			    effect.num_captured_stones += cluster.size;
+		    }
+	    });
+	liberties.reset(action.pos);
+
+	// the captured stones next to the played stone or to a merged cluster
+	// become liberties
+	auto is_merged = [&](uint32_t cell_idx) {
+		if (cell_idx == action.pos)
+			return true;
+		if (board_state.board[cell_idx] != PLAYERS[action.player_index])
+			return false;
+		const uint32_t root = get_cluster_idx(table, cell_idx);
+		return std::find(
+		           merged_roots.begin(), merged_roots.begin() + merged_count,
+		           root) != merged_roots.begin() + merged_count;
+	};
+	for (uint32_t i = 0; i < effect.captured_count; i++)
 	{
-		const Action& last = state.move_history.back();
-		const Action& before_last = state.move_history.rbegin()[1];
-		return is_pass(last) && is_pass(before_last);
+		const Cluster& captured = table.clusters[effect.captured_roots[i]];
+		for_each_cluster_cell(table, captured, [&](uint32_t cell_idx) {
+			for_each_neighbor(board_state, cell_idx, [&](uint32_t neighbor) {
+				if (is_merged(neighbor))
+				{
+					liberties.set(cell_idx);
+					return BREAK;
+				}
+				return CONTINUE;
+			});
+		});
 	}
-	else
+
+	effect.num_liberties = liberties.count();
+	effect.is_self_atari = effect.num_liberties == 1;
+	// a lone stone capturing a single stone, as in get_ko
+	if (!has_empty_neighbor && merged_count == 0 &&
+	    effect.num_captured_stones == 1)
+		effect.ko = effect.captured_roots[0];
+	return effect;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+uint32_t go::engine::calculate_pattern(
+    const BasicPlayoutState<BoardSize, Liberties>& state, uint32_t cell_idx)
+{
+	const auto& tables = details::PATTERN_TABLES<BoardSize>;
+	const auto& board = state.board_state.board;
+	uint32_t code = tables.empty_codes[cell_idx];
+	for (uint32_t d = 0; d < details::NUM_PATTERN_NEIGHBORS; d++)
 	{
-		return false;
+		const uint32_t neighbor = cell_idx + tables.offsets[d];
+		if (board[neighbor] != Cell::BLACK && board[neighbor] != Cell::WHITE)
+			continue;
+		uint32_t digit = 1 + get_player_index(board[neighbor]);
+		const uint32_t root = get_cluster_idx(state.cluster_table, neighbor);
+		if (d < details::NUM_ORTHOGONAL_NEIGHBORS &&
+		    state.atari_clusters.contains(root))
+			digit += PATTERN_ATARI_DIGIT;
+		code += digit * tables.weights[cell_idx][d];
 	}
+	return code;
 }
+
+#define INSTANTIATE_ENGINE(N, L)                                               \
+	template bool go::engine::make_move(BasicGameState<N, L>&, const Action&); \
+	template bool go::engine::make_move(                                       \
+	    BasicPlayoutState<N, L>&, const Action&);                              \
+	template bool go::engine::unmake_move(BasicGameState<N, L>&);              \
+	template bool go::engine::is_valid_move(                                   \
+	    const BasicClusterTable<N, L>&, const BasicBoardState<N>&,             \
+	    const Action&);                                                        \
+	template bool go::engine::is_valid_move(                                   \
+	    const BasicPlayoutState<N, L>&, const Action&);                        \
+	template bool go::engine::is_valid_move(                                   \
+	    const BasicGameState<N, L>&, const Action&);                           \
+	template void go::engine::update_legal_moves(                              \
+	    BasicPlayoutState<N, L>&, uint32_t);                                   \
+	template bool go::engine::is_suicide_move(                                 \
+	    const BasicClusterTable<N, L>&, const BasicBoardState<N>&,             \
+	    const Action&);                                                        \
+	template bool go::engine::is_terminal_state(                               \
+	    const BasicPlayoutState<N, L>&);                                       \
+	template bool go::engine::is_terminal_state(const BasicGameState<N, L>&);  \
+	template uint64_t go::engine::get_hash_after_move(                         \
+	    const BasicPlayoutState<N, L>&, const Action&);                        \
+	template bool go::engine::is_superko(                                      \
+	    const BasicGameState<N, L>&, const Action&);                           \
+	template uint32_t go::engine::calculate_pattern(                           \
+	    const BasicPlayoutState<N, L>&, uint32_t);                             \
+	template MoveEffect go::engine::analyze_move(                              \
+	    const BasicPlayoutState<N, L>&, const Action&);
+
+#define INSTANTIATE_SCORE(N)                                                   \
+	template void go::engine::calculate_score(                                 \
+	    const BasicBoardState<N>&, Player&, Player&);
+
+FOR_EACH_LIBERTY_MODEL(INSTANTIATE_ENGINE)
+FOR_EACH_BOARD_SIZE(INSTANTIATE_SCORE)
@@ -0,0 +1,73 @@
+#ifndef SRC_ENGINE_FENWICK_H_
+#define SRC_ENGINE_FENWICK_H_
+
+#include <array>
+#include <assert.h>
+#include <stdint.h>
+
+namespace go
+{
+namespace engine
+{
+
+// Sums of Size values with O(log Size) updates and prefix searches, used to
+// draw an index with probability proportional to its value
+template <uint32_t Size>
+struct FenwickTree
+{
+	// tree[i] is the sum of the values in (i - lowest bit of i, i], 1 based
+	std::array<uint32_t, Size + 1> tree;
+	std::array<uint32_t, Size> values;
+	uint32_t total;
+
+	FenwickTree() : tree{}, values{}, total{0}
+	{
+	}
+
+	uint32_t operator[](uint32_t idx) const
+	{
+		return values[idx];
+	}
+
+	void set(uint32_t idx, uint32_t value)
+	{
+		if (values[idx] == value)
+			return;
+		// wraps around when the value decreases, as do the sums
+		const uint32_t delta = value - values[idx];
+		values[idx] = value;
+		total += delta;
+		for (uint32_t i = idx + 1; i <= Size; i += i & (0u - i))
+			tree[i] += delta;
+	}
+
+	// the index whose range of cumulative sums contains target, which must
+	// be less than total
+	uint32_t find(uint32_t target) const
+	{
+		assert(target < total);
+		uint32_t idx = 0;
+		for (uint32_t step = highest_power_of_two(); step != 0; step >>= 1)
+		{
+			if (idx + step <= Size && tree[idx + step] <= target)
+			{
+				idx += step;
+				target -= tree[idx];
+			}
+		}
+		return idx;
+	}
+
+	static constexpr uint32_t highest_power_of_two()
+	{
+		uint32_t power = 1;
+		while (power * 2 <= Size)
+			power *= 2;
+		return power;
+	}
+};
+
+} // namespace engine
+} // namespace go
+
+#endif // SRC_ENGINE_FENWICK_H_
@@ -2,6 +2,7 @@
 #define SRC_ENGINE_INTERFACE_H_
 
 #include "board.h"
+#include "zobrist.h"
 
 namespace go
 {
@@ -9,19 +10,127 @@ namespace engine
 {
 
 // Plays a move, if legal, changing the board state and game state
-bool make_move(GameState&, const Action&);
+template <uint32_t BoardSize, typename Liberties>
+bool make_move(BasicGameState<BoardSize, Liberties>&, const Action&);
+// Same as above, without recording the move, superko isn't checked
+template <uint32_t BoardSize, typename Liberties>
+bool make_move(BasicPlayoutState<BoardSize, Liberties>&, const Action&);
+// Reverts the last move played with make_move, returns false if there is none
+template <uint32_t BoardSize, typename Liberties>
+bool unmake_move(BasicGameState<BoardSize, Liberties>&);
 
-bool is_valid_move(const ClusterTable& table, const BoardState&, const Action&);
+template <uint32_t BoardSize, typename Liberties>
+bool is_valid_move(
+    const BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>&, const Action&);
+// Same as above, using the legal moves maintained in the state
+template <uint32_t BoardSize, typename Liberties>
+bool is_valid_move(
+    const BasicPlayoutState<BoardSize, Liberties>&, const Action&);
+// Same as above, also applying the rules that depend on the game history
+template <uint32_t BoardSize, typename Liberties>
+bool is_valid_move(const BasicGameState<BoardSize, Liberties>&, const Action&);
+// Recomputes whether each player is allowed to play at the cell
+template <uint32_t BoardSize, typename Liberties>
+void update_legal_moves(
+    BasicPlayoutState<BoardSize, Liberties>&, uint32_t cell_idx);
+template <uint32_t BoardSize, typename Liberties>
 bool is_suicide_move(
-    const ClusterTable& table, const BoardState&, const Action&);
-bool is_terminal_state(const GameState&);
-void calculate_score(const BoardState&, Player&, Player&);
+    const BasicClusterTable<BoardSize, Liberties>& table,
+    const BasicBoardState<BoardSize>&, const Action&);
+// The game ends after two passes in a row
+template <uint32_t BoardSize, typename Liberties>
+bool is_terminal_state(const BasicPlayoutState<BoardSize, Liberties>&);
+// Same as above, also ending the game when the move history is full
+template <uint32_t BoardSize, typename Liberties>
+bool is_terminal_state(const BasicGameState<BoardSize, Liberties>&);
+// Hash of the position that the action would lead to, without playing it
+template <uint32_t BoardSize, typename Liberties>
+uint64_t get_hash_after_move(
+    const BasicPlayoutState<BoardSize, Liberties>&, const Action&);
+// Reports what playing the action would capture and leave to the played
+// stone, without playing it. The action must be valid, a pass has no effect
+template <uint32_t BoardSize, typename Liberties>
+MoveEffect
+analyze_move(const BasicPlayoutState<BoardSize, Liberties>&, const Action&);
+// Checks if the action recreates a previous position of the game
+template <uint32_t BoardSize, typename Liberties>
+bool is_superko(const BasicGameState<BoardSize, Liberties>&, const Action&);
+template <uint32_t BoardSize>
+void calculate_score(const BasicBoardState<BoardSize>&, Player&, Player&);
+// Sets the total score of each player given the territory they own
+void set_total_scores(
+    uint32_t black_territory_score, uint32_t white_territory_score,
+    Player& black_player, Player& white_player);
 
-inline bool is_ko(const BoardState& board_state, const Action& action)
+template <uint32_t BoardSize>
+inline bool
+is_ko(const BasicBoardState<BoardSize>& board_state, const Action& action)
 {
 	return action.pos == board_state.ko;
 }
 
+// Whether the empty cell looks like an eye of the player: all its orthogonal
+// neighbors are the player's stones, and the enemy holds at most one of its
+// diagonal neighbors, none if the cell is on the edge. Filling such a cell
+// is almost never useful, so playouts skip it.
+template <uint32_t BoardSize>
+inline bool is_eye_like(
+    const BasicBoardState<BoardSize>& board_state, uint32_t cell_idx,
+    uint32_t player_index)
+{
+	constexpr uint32_t ROW = BasicBoardState<BoardSize>::EXTENDED_BOARD_SIZE;
+	const auto& board = board_state.board;
+	const Cell stone = PLAYERS[player_index];
+	for (uint32_t neighbor :
+	     {cell_idx + 1, cell_idx - ROW, cell_idx - 1, cell_idx + ROW})
+		if (board[neighbor] != stone && board[neighbor] != Cell::BORDER)
+			return false;
+
+	const Cell enemy_stone = PLAYERS[1 - player_index];
+	uint32_t num_enemies = 0;
+	bool on_edge = false;
+	for (uint32_t diagonal :
+	     {cell_idx - ROW + 1, cell_idx - ROW - 1, cell_idx + ROW - 1,
+	      cell_idx + ROW + 1})
+	{
+		num_enemies += board[diagonal] == enemy_stone;
+		on_edge |= board[diagonal] == Cell::BORDER;
+	}
+	return num_enemies == 0 || (num_enemies == 1 && !on_edge);
+}
+
+// Pattern code of the cell computed from scratch, PlayoutState::patterns is
+// kept equal to this incrementally
+template <uint32_t BoardSize, typename Liberties>
+uint32_t
+calculate_pattern(const BasicPlayoutState<BoardSize, Liberties>&, uint32_t);
+
+// Board changes go through these to keep the hash, the empty cells list and
+// the patterns in sync with the board
+template <uint32_t BoardSize, typename Liberties>
+inline void place_stone(
+    BasicPlayoutState<BoardSize, Liberties>& game_state, uint32_t cell_idx,
+    uint32_t player_index)
+{
+	game_state.board_state.board[cell_idx] = PLAYERS[player_index];
+	game_state.hash ^= zobrist_key(player_index, cell_idx);
+	game_state.empty_cells.remove(cell_idx);
+	game_state.patterns.add_stone(cell_idx, player_index);
+}
+
+template <uint32_t BoardSize, typename Liberties>
+inline void remove_stone(
+    BasicPlayoutState<BoardSize, Liberties>& game_state, uint32_t cell_idx)
+{
+	Cell& cell = game_state.board_state.board[cell_idx];
+	const uint32_t player_index = get_player_index(cell);
+	game_state.hash ^= zobrist_key(player_index, cell_idx);
+	game_state.empty_cells.insert(cell_idx);
+	game_state.patterns.remove_stone(cell_idx, player_index);
+	cell = Cell::EMPTY;
+}
+
 } // namespace engine
 } // namespace go
 
@@ -0,0 +1,159 @@
+
+#include "cluster.h"
+#include "interface.h"
+#include "ladder.h"
+#include "utility.h"
+
+using namespace go::engine;
+
+// The state of a ladder reading, the cluster is followed through its stone
+// at cluster_idx as its root changes when it extends
+template <uint32_t BoardSize, typename Liberties>
+struct LadderReader
+{
+	BasicGameState<BoardSize, Liberties>& state;
+	uint32_t cluster_idx;
+	uint32_t nodes_left;
+	// set once a move is skipped for lack of budget, the result is then
+	// unreliable
+	bool out_of_nodes;
+};
+
+template <uint32_t BoardSize, typename Liberties>
+static bool read_attack(LadderReader<BoardSize, Liberties>&);
+template <uint32_t BoardSize, typename Liberties>
+static bool read_defense(LadderReader<BoardSize, Liberties>&);
+
+// Plays the action if valid and within budget, then reads the position with
+// next and reverts the action. Returns whether the action was played, with
+// next's result in result.
+template <uint32_t BoardSize, typename Liberties, typename Next>
+static bool try_move(
+    LadderReader<BoardSize, Liberties>& reader, uint32_t pos, Next&& next,
+    bool& result)
+{
+	auto& state = reader.state;
+	Action action = {pos, state.player_turn};
+	if (reader.nodes_left == 0)
+	{
+		reader.out_of_nodes = true;
+		return false;
+	}
+	if (!is_valid_move(state, action))
+		return false;
+	reader.nodes_left--;
+	make_move(state, action);
+	result = next(reader);
+	unmake_move(state);
+	return true;
+}
+
+// The cluster's owner is to move and the cluster is in atari. It escapes by
+// extending at its liberty or by capturing a stone next to it.
+template <uint32_t BoardSize, typename Liberties>
+static bool read_defense(LadderReader<BoardSize, Liberties>& reader)
+{
+	constexpr uint32_t MAX_CANDIDATES = 8;
+	const auto& state = reader.state;
+	const auto& table = state.cluster_table;
+	const auto& board_state = state.board_state;
+	const Cluster& cluster = get_cluster(table, reader.cluster_idx);
+
+	std::array<uint32_t, MAX_CANDIDATES> candidates;
+	uint32_t num_candidates = 0;
+	candidates[num_candidates++] =
+	    state.atari_clusters.liberties[cluster.parent_idx];
+	for_each_cluster_cell(table, cluster, [&](uint32_t cell_idx) {
+		for_each_neighbor(board_state, cell_idx, [&](uint32_t neighbor) {
+			const Cell cell = board_state.board[neighbor];
+			if (cell == Cell::EMPTY || cell == PLAYERS[cluster.player])
+				return CONTINUE;
+			const uint32_t root = get_cluster_idx(table, neighbor);
+			if (!state.atari_clusters.contains(root))
+				return CONTINUE;
+			const uint32_t liberty = state.atari_clusters.liberties[root];
+			const auto end = candidates.begin() + num_candidates;
+			if (std::find(candidates.begin(), end, liberty) == end)
+				candidates[num_candidates++] = liberty;
+			return num_candidates == MAX_CANDIDATES ? BREAK : CONTINUE;
+		});
+		return num_candidates == MAX_CANDIDATES ? BREAK : CONTINUE;
+	});
+
+	for (uint32_t i = 0; i < num_candidates; i++)
+	{
+		bool captured = false;
+		if (try_move(
+		        reader, candidates[i], read_attack<BoardSize, Liberties>,
+		        captured) &&
+		    !captured)
+			return false;
+	}
+	return true;
+}
+
+// The opponent is to move. The cluster is captured if it is in atari, and
+// escapes if it has more than two liberties. Otherwise each liberty is tried
+// as an atari.
+template <uint32_t BoardSize, typename Liberties>
+static bool read_attack(LadderReader<BoardSize, Liberties>& reader)
+{
+	const auto& state = reader.state;
+	const auto& table = state.cluster_table;
+	const Cluster& cluster = get_cluster(table, reader.cluster_idx);
+	if (state.atari_clusters.contains(cluster.parent_idx))
+		return true;
+
+	BasicBitboard<BoardSize> liberties;
+	mark_liberties(liberties, table, state.board_state, cluster);
+	if (liberties.count() > 2)
+		return false;
+
+	std::array<uint32_t, 2> atari_moves;
+	uint32_t num_moves = 0;
+	for_each_cell(liberties, [&](uint32_t cell_idx) {
+		atari_moves[num_moves++] = cell_idx;
+	});
+
+	for (uint32_t pos : atari_moves)
+	{
+		bool captured = false;
+		auto defend = [](LadderReader<BoardSize, Liberties>& next_reader) {
+			const auto& next_state = next_reader.state;
+			const uint32_t root = get_cluster_idx(
+			    next_state.cluster_table, next_reader.cluster_idx);
+			// the atari failed, e.g. the stone played is captured
+			if (!next_state.atari_clusters.contains(root))
+				return false;
+			return read_defense(next_reader);
+		};
+		if (try_move(reader, pos, defend, captured) && captured)
+			return true;
+	}
+	return false;
+}
+
+template <uint32_t BoardSize, typename Liberties>
+bool go::engine::is_ladder_capture(
+    BasicGameState<BoardSize, Liberties>& state, uint32_t cluster_idx,
+    uint32_t max_nodes)
+{
+	const Cluster& cluster = get_cluster(state.cluster_table, cluster_idx);
+	// every move read is taken back, the line must fit in the journal
+	LadderReader<BoardSize, Liberties> reader = {
+	    state, cluster_idx, std::min(max_nodes, MAX_UNDO_MOVES), false};
+	bool captured;
+	if (state.player_turn != cluster.player)
+		captured = read_attack(reader);
+	else if (state.atari_clusters.contains(cluster.parent_idx))
+		captured = read_defense(reader);
+	else
+		captured = false;
+	return captured && !reader.out_of_nodes;
+}
+
+#define INSTANTIATE_LADDER(N, L)                                               \
+	template bool go::engine::is_ladder_capture(                               \
+	    BasicGameState<N, L>&, uint32_t, uint32_t);
+
+FOR_EACH_LIBERTY_MODEL(INSTANTIATE_LADDER)
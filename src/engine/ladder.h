@@ -0,0 +1,30 @@
+#ifndef SRC_ENGINE_LADDER_H_
+#define SRC_ENGINE_LADDER_H_
+
+#include <stdint.h>
+
+#include "board.h"
+
+namespace go
+{
+namespace engine
+{
+
+static constexpr uint32_t DEFAULT_LADDER_MAX_NODES = 200;
+static_assert(DEFAULT_LADDER_MAX_NODES <= MAX_UNDO_MOVES);
+
+// Reads the ladder on the cluster of the stone at cluster_idx by playing the
+// atari and escape moves on the state, which is restored before returning.
+// With the cluster's owner to move, the cluster must be in atari; with the
+// opponent to move, it is put in atari at one of its two liberties. Returns
+// true if the cluster can't escape, false if it can or if reading it takes
+// more than max_nodes moves, at most MAX_UNDO_MOVES.
+template <uint32_t BoardSize, typename Liberties>
+bool is_ladder_capture(
+    BasicGameState<BoardSize, Liberties>&, uint32_t cluster_idx,
+    uint32_t max_nodes = DEFAULT_LADDER_MAX_NODES);
+
+} // namespace engine
+} // namespace go
+
+#endif // SRC_ENGINE_LADDER_H_
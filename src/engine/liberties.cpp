@@ -6,10 +6,11 @@
 #include "liberties.h"
 #include "utility.h"
 
-using go::engine::BoardState;
-using go::engine::Cell;
+using namespace go::engine;
 
-uint32_t go::engine::count_liberties(const BoardState& state, uint32_t cell_idx)
+template <uint32_t BoardSize>
+uint32_t go::engine::count_liberties(
+    const BasicBoardState<BoardSize>& state, uint32_t cell_idx)
 {
 	uint32_t num_liberties = 0;
 	for_each_cell(state, cell_idx, [&](uint32_t cur_idx) {
@@ -22,20 +23,39 @@ uint32_t go::engine::count_liberties(const BoardState& state, uint32_t cell_idx)
 	return num_liberties;
 }
 
-uint32_t
-go::engine::count_liberties(const BoardState& state, uint32_t i, uint32_t j)
+template <uint32_t BoardSize>
+uint32_t go::engine::count_liberties(
+    const BasicBoardState<BoardSize>& state, uint32_t i, uint32_t j)
 {
-	return count_liberties(state, BoardState::index(i, j));
+	return count_liberties(state, BasicBoardState<BoardSize>::index(i, j));
 }
 
-uint32_t
-go::engine::count_liberties(const ClusterTable& table, uint32_t i, uint32_t j)
+template <uint32_t BoardSize, typename Liberties>
+uint32_t go::engine::count_liberties(
+    const BasicClusterTable<BoardSize, Liberties>& table, uint32_t i,
+    uint32_t j)
 {
-	return count_liberties(table, BoardState::index(i, j));
+	return count_liberties(table, BasicBoardState<BoardSize>::index(i, j));
 }
 
-uint32_t
-go::engine::count_liberties(const ClusterTable& table, uint32_t cell_idx)
+template <uint32_t BoardSize, typename Liberties>
+uint32_t go::engine::count_liberties(
+    const BasicClusterTable<BoardSize, Liberties>& table, uint32_t cell_idx)
 {
 	return get_num_liberties(get_cluster(table, cell_idx));
 }
+
+#define INSTANTIATE_LIBERTIES(N)                                               \
+	template uint32_t go::engine::count_liberties(                             \
+	    const BasicBoardState<N>&, uint32_t, uint32_t);                        \
+	template uint32_t go::engine::count_liberties(                             \
+	    const BasicBoardState<N>&, uint32_t);
+
+#define INSTANTIATE_CACHED_LIBERTIES(N, L)                                     \
+	template uint32_t go::engine::count_liberties(                             \
+	    const BasicClusterTable<N, L>&, uint32_t, uint32_t);                   \
+	template uint32_t go::engine::count_liberties(                             \
+	    const BasicClusterTable<N, L>&, uint32_t);
+
+FOR_EACH_BOARD_SIZE(INSTANTIATE_LIBERTIES)
+FOR_EACH_LIBERTY_MODEL(INSTANTIATE_CACHED_LIBERTIES)
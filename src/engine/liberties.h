@@ -7,17 +7,29 @@ namespace go
 {
 namespace engine
 {
-struct BoardState;
-struct ClusterTable;
+template <uint32_t BoardSize>
+struct BasicBoardState;
+template <uint32_t BoardSize, typename Liberties>
+struct BasicClusterTable;
 
 // Slowest and most basic liberty counting function that doesn't depend
 // on cached data
-uint32_t count_liberties(const BoardState& state, uint32_t i, uint32_t j);
-uint32_t count_liberties(const BoardState& state, uint32_t cell_idx);
+template <uint32_t BoardSize>
+uint32_t count_liberties(
+    const BasicBoardState<BoardSize>& state, uint32_t i, uint32_t j);
+template <uint32_t BoardSize>
+uint32_t
+count_liberties(const BasicBoardState<BoardSize>& state, uint32_t cell_idx);
 
-// Finds liberty count from cached data
-uint32_t count_liberties(const ClusterTable& table, uint32_t i, uint32_t j);
-uint32_t count_liberties(const ClusterTable& table, uint32_t cell_idx);
+// Finds liberty count from cached data, pseudo liberties are counted with
+// pseudo liberty tables
+template <uint32_t BoardSize, typename Liberties>
+uint32_t count_liberties(
+    const BasicClusterTable<BoardSize, Liberties>& table, uint32_t i,
+    uint32_t j);
+template <uint32_t BoardSize, typename Liberties>
+uint32_t count_liberties(
+    const BasicClusterTable<BoardSize, Liberties>& table, uint32_t cell_idx);
 
 } // namespace engine
 } // namespace go
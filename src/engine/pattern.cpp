@@ -0,0 +1,9 @@
+#include "pattern.h"
+
+using namespace go::engine;
+
+// The players' tables are evaluated separately, which keeps each evaluation
+// within the compilers' constexpr limits, so that the table is built at
+// compile time.
+const std::array<std::array<uint16_t, 65536>, 2> go::engine::PATTERN_WEIGHTS =
+    {details::make_pattern_weights(0), details::make_pattern_weights(1)};
@@ -0,0 +1,330 @@
+#ifndef SRC_ENGINE_PATTERN_H_
+#define SRC_ENGINE_PATTERN_H_
+
+#include <array>
+#include <bitset>
+#include <stdint.h>
+
+#include "fenwick.h"
+
+namespace go
+{
+namespace engine
+{
+
+// The pattern code of a cell describes its 3x3 neighborhood: the color of the
+// 8 neighbors and whether the stones next to it are in atari. Each neighbor
+// inside the board adds a digit times its weight to the code, the weights
+// being those of a mixed radix number whose offset depends on the border
+// cells around. So the codes of all boards are dense in [0, NUM_PATTERNS).
+//
+// The digit of a neighbor is 0 when empty, 1 + player index for a stone, plus
+// 2 for a stone next to the cell whose cluster is in atari.
+static constexpr uint32_t PATTERN_ATARI_DIGIT = 2;
+
+namespace details
+{
+// neighbors in pattern order: right, up, left, down, then up right, up left,
+// down left and down right. The neighbor in direction d sees the cell in
+// direction OPPOSITE_DIRECTIONS[d]
+static constexpr uint32_t NUM_PATTERN_NEIGHBORS = 8;
+static constexpr uint32_t NUM_ORTHOGONAL_NEIGHBORS = 4;
+static constexpr std::array<uint32_t, NUM_PATTERN_NEIGHBORS>
+    OPPOSITE_DIRECTIONS = {2, 3, 0, 1, 6, 7, 4, 5};
+static constexpr uint32_t ORTHOGONAL_RADIX = 5;
+static constexpr uint32_t DIAGONAL_RADIX = 3;
+
+// A cell is in the pattern class given by which of its orthogonal neighbors
+// are outside the board, one bit per direction. A diagonal neighbor is
+// outside iff one of the two orthogonal neighbors next to it is. The codes
+// of a class follow those of the classes with a lower mask
+static constexpr uint32_t NUM_PATTERN_CLASSES = 16;
+
+constexpr bool is_valid_pattern_class(uint32_t mask)
+{
+	// a cell can't be on two opposite edges
+	return (mask & 5) != 5 && (mask & 10) != 10;
+}
+
+constexpr std::array<bool, NUM_PATTERN_NEIGHBORS>
+get_pattern_class_neighbors(uint32_t mask)
+{
+	std::array<bool, NUM_PATTERN_NEIGHBORS> on_board{};
+	for (uint32_t d = 0; d < NUM_ORTHOGONAL_NEIGHBORS; d++)
+	{
+		const uint32_t next = (d + 1) % NUM_ORTHOGONAL_NEIGHBORS;
+		on_board[d] = ((mask >> d) & 1) == 0;
+		on_board[NUM_ORTHOGONAL_NEIGHBORS + d] =
+		    ((mask >> d) & 1) == 0 && ((mask >> next) & 1) == 0;
+	}
+	return on_board;
+}
+
+constexpr uint32_t get_pattern_radix(uint32_t direction)
+{
+	return direction < NUM_ORTHOGONAL_NEIGHBORS ? ORTHOGONAL_RADIX
+	                                            : DIAGONAL_RADIX;
+}
+
+constexpr uint32_t get_pattern_class_size(uint32_t mask)
+{
+	const auto on_board = get_pattern_class_neighbors(mask);
+	uint32_t size = 1;
+	for (uint32_t d = 0; d < NUM_PATTERN_NEIGHBORS; d++)
+		if (on_board[d])
+			size *= get_pattern_radix(d);
+	return size;
+}
+
+template <uint32_t BoardSize>
+struct PatternTables
+{
+	static constexpr uint32_t ROW = BoardSize + 2;
+	static constexpr uint32_t NUM_CELLS = ROW * ROW;
+
+	// cell index offset of each neighbor, wrapping around for the negative
+	// ones
+	std::array<uint32_t, NUM_PATTERN_NEIGHBORS> offsets;
+	// weight of each neighbor in the code of each cell, 0 for the neighbors
+	// outside the board and for all the neighbors of border cells
+	std::array<std::array<uint16_t, NUM_PATTERN_NEIGHBORS>, NUM_CELLS> weights;
+	// code of each cell on an empty board
+	std::array<uint16_t, NUM_CELLS> empty_codes;
+	uint32_t num_patterns;
+};
+
+template <uint32_t BoardSize>
+constexpr bool is_border(uint32_t cell_idx)
+{
+	constexpr uint32_t ROW = PatternTables<BoardSize>::ROW;
+	const uint32_t i = cell_idx / ROW;
+	const uint32_t j = cell_idx % ROW;
+	return i == 0 || j == 0 || i == ROW - 1 || j == ROW - 1;
+}
+
+template <uint32_t BoardSize>
+constexpr PatternTables<BoardSize> make_pattern_tables()
+{
+	using Tables = PatternTables<BoardSize>;
+	Tables tables{};
+	constexpr uint32_t ROW = Tables::ROW;
+	tables.offsets = {1u,       0u - ROW,      0u - 1u,  ROW,
+	                  1u - ROW, 0u - ROW - 1u, ROW - 1u, ROW + 1u};
+
+	std::array<uint32_t, NUM_PATTERN_CLASSES> class_offsets{};
+	uint32_t num_patterns = 0;
+	for (uint32_t mask = 0; mask < NUM_PATTERN_CLASSES; mask++)
+	{
+		if (!is_valid_pattern_class(mask))
+			continue;
+		class_offsets[mask] = num_patterns;
+		num_patterns += get_pattern_class_size(mask);
+	}
+	tables.num_patterns = num_patterns;
+
+	for (uint32_t cell = 0; cell < Tables::NUM_CELLS; cell++)
+	{
+		if (is_border<BoardSize>(cell))
+			continue;
+		uint32_t mask = 0;
+		uint32_t weight = 1;
+		for (uint32_t d = 0; d < NUM_PATTERN_NEIGHBORS; d++)
+		{
+			if (is_border<BoardSize>(cell + tables.offsets[d]))
+			{
+				if (d < NUM_ORTHOGONAL_NEIGHBORS)
+					mask |= 1u << d;
+				continue;
+			}
+			tables.weights[cell][d] = uint16_t(weight);
+			weight *= get_pattern_radix(d);
+		}
+		tables.empty_codes[cell] = uint16_t(class_offsets[mask]);
+	}
+	return tables;
+}
+
+template <uint32_t BoardSize>
+inline constexpr PatternTables<BoardSize> PATTERN_TABLES =
+    make_pattern_tables<BoardSize>();
+
+// Weight added to a playout move of the player by a neighbor in a pattern:
+// captures first, then atari escapes, then contact moves
+constexpr uint32_t
+get_neighbor_weight(uint32_t digit, uint32_t player_index)
+{
+	if (digit == 0)
+		return 0;
+	const bool is_friend = (digit - 1) % 2 == player_index;
+	if (digit > PATTERN_ATARI_DIGIT)
+		return is_friend ? 64 : 256;
+	return is_friend ? 0 : 8;
+}
+
+// The moves of a player in a pattern that looks like the player's eye get no
+// weight, see is_eye_like
+constexpr std::array<uint16_t, 65536>
+make_pattern_weights(uint32_t player_index)
+{
+	constexpr uint32_t BASE_WEIGHT = 16;
+	constexpr uint32_t MAX_DIGIT = 2 + PATTERN_ATARI_DIGIT;
+	std::array<uint32_t, MAX_DIGIT + 1> neighbor_weights{};
+	std::array<uint32_t, MAX_DIGIT + 1> is_friend{};
+	std::array<uint32_t, MAX_DIGIT + 1> is_enemy{};
+	for (uint32_t digit = 1; digit <= MAX_DIGIT; digit++)
+	{
+		neighbor_weights[digit] = get_neighbor_weight(digit, player_index);
+		is_friend[digit] = (digit - 1) % 2 == player_index;
+		is_enemy[digit] = (digit - 1) % 2 != player_index;
+	}
+
+	std::array<uint16_t, 65536> weights{};
+	uint32_t code = 0;
+	for (uint32_t mask = 0; mask < NUM_PATTERN_CLASSES; mask++)
+	{
+		if (!is_valid_pattern_class(mask))
+			continue;
+		const auto on_board = get_pattern_class_neighbors(mask);
+		std::array<uint32_t, NUM_PATTERN_NEIGHBORS> directions{};
+		uint32_t num_digits = 0;
+		uint32_t num_orthogonal = 0;
+		for (uint32_t d = 0; d < NUM_PATTERN_NEIGHBORS; d++)
+		{
+			if (on_board[d])
+				directions[num_digits++] = d;
+			if (on_board[d] && d < NUM_ORTHOGONAL_NEIGHBORS)
+				num_orthogonal++;
+		}
+		const uint32_t max_diagonal_enemies = mask == 0 ? 1 : 0;
+
+		// the digits are counted up like a mixed radix number, keeping the
+		// weights of the current digits summed, and the friend orthogonal
+		// and enemy diagonal neighbors counted
+		std::array<uint32_t, NUM_PATTERN_NEIGHBORS> digits{};
+		uint32_t sum = BASE_WEIGHT;
+		uint32_t num_friends = 0;
+		uint32_t num_enemies = 0;
+		const uint32_t class_size = get_pattern_class_size(mask);
+		for (uint32_t i = 0; i < class_size; i++, code++)
+		{
+			const bool is_eye_like = num_friends == num_orthogonal &&
+			                         num_enemies <= max_diagonal_enemies;
+			weights[code] = uint16_t(is_eye_like ? 0 : sum);
+			for (uint32_t k = 0; k < num_digits; k++)
+			{
+				const uint32_t d = directions[k];
+				const uint32_t digit = digits[k];
+				const uint32_t next =
+				    digit + 1 == get_pattern_radix(d) ? 0 : digit + 1;
+				sum = sum + neighbor_weights[next] - neighbor_weights[digit];
+				if (d < NUM_ORTHOGONAL_NEIGHBORS)
+					num_friends += is_friend[next] - is_friend[digit];
+				else
+					num_enemies += is_enemy[next] - is_enemy[digit];
+				digits[k] = next;
+				if (next != 0)
+					break;
+			}
+		}
+	}
+	return weights;
+}
+} // namespace details
+
+// Playout weight of each pattern code for each player, generated at compile
+// time in pattern.cpp from the neighbor weights above
+extern const std::array<std::array<uint16_t, 65536>, 2> PATTERN_WEIGHTS;
+
+template <uint32_t BoardSize>
+inline constexpr uint32_t NUM_PATTERNS =
+    details::PATTERN_TABLES<BoardSize>.num_patterns;
+
+static_assert(NUM_PATTERNS<19> <= 65536);
+
+// Pattern code of every cell of the board. The codes around a cell are
+// updated when a stone is placed or removed there, and around the stones of
+// a cluster when it enters or leaves atari. The pattern weight of each empty
+// cell is kept in a Fenwick tree per player, to draw playout moves.
+template <uint32_t BoardSize>
+struct BasicPatterns
+{
+	using Tables = details::PatternTables<BoardSize>;
+
+	std::array<uint16_t, Tables::NUM_CELLS> codes;
+	// weight of each cell for each player, 0 for the occupied cells
+	std::array<FenwickTree<Tables::NUM_CELLS>, 2> weights;
+	// cells with a stone or outside the board
+	std::bitset<Tables::NUM_CELLS> occupied;
+
+	BasicPatterns() : codes(details::PATTERN_TABLES<BoardSize>.empty_codes)
+	{
+		for (uint32_t i = 0; i < Tables::NUM_CELLS; i++)
+		{
+			if (details::is_border<BoardSize>(i))
+				occupied.set(i, true);
+			else
+				update_weights(i);
+		}
+	}
+
+	uint32_t operator[](uint32_t cell_idx) const
+	{
+		return codes[cell_idx];
+	}
+
+	// the stone must not be flagged as in atari
+	void add_stone(uint32_t cell_idx, uint32_t player_index)
+	{
+		occupied.set(cell_idx, true);
+		update_weights(cell_idx);
+		add_digits(cell_idx, 1 + player_index, 1 + player_index);
+	}
+	void remove_stone(uint32_t cell_idx, uint32_t player_index)
+	{
+		occupied.set(cell_idx, false);
+		update_weights(cell_idx);
+		// the codes wrap around, so adding the opposite digits subtracts them
+		add_digits(cell_idx, 0u - (1 + player_index), 0u - (1 + player_index));
+	}
+	void add_atari(uint32_t cell_idx)
+	{
+		add_digits(cell_idx, PATTERN_ATARI_DIGIT, 0);
+	}
+	void remove_atari(uint32_t cell_idx)
+	{
+		add_digits(cell_idx, 0u - PATTERN_ATARI_DIGIT, 0);
+	}
+
+	// adds the digits of the cell to the codes of its neighbors, the digit
+	// seen by its orthogonal neighbors and the one seen by the diagonal ones
+	void add_digits(
+	    uint32_t cell_idx, uint32_t orthogonal_digit, uint32_t diagonal_digit)
+	{
+		const auto& tables = details::PATTERN_TABLES<BoardSize>;
+		for (uint32_t d = 0; d < details::NUM_PATTERN_NEIGHBORS; d++)
+		{
+			const uint32_t neighbor = cell_idx + tables.offsets[d];
+			const uint32_t digit = d < details::NUM_ORTHOGONAL_NEIGHBORS
+			                           ? orthogonal_digit
+			                           : diagonal_digit;
+			const uint32_t weight =
+			    tables.weights[neighbor][details::OPPOSITE_DIRECTIONS[d]];
+			codes[neighbor] = uint16_t(codes[neighbor] + digit * weight);
+			update_weights(neighbor);
+		}
+	}
+
+	void update_weights(uint32_t cell_idx)
+	{
+		for (uint32_t player = 0; player < 2; player++)
+			weights[player].set(
+			    cell_idx, occupied[cell_idx]
+			                  ? 0
+			                  : PATTERN_WEIGHTS[player][codes[cell_idx]]);
+	}
+};
+
+} // namespace engine
+} // namespace go
+
+#endif // SRC_ENGINE_PATTERN_H_
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <array>
+#include <random>
 #include <type_traits>
 
 #include "board.h"
@@ -39,10 +40,12 @@ auto wrap_void_lambda(Lambda&& lambda)
 }
 } // namespace details
 
-template <typename Lambda>
+template <uint32_t BoardSize, typename Lambda>
 void for_each_neighbor(
-    const BoardState& state, uint32_t cell_idx, Lambda&& lambda)
+    const BasicBoardState<BoardSize>& state, uint32_t cell_idx,
+    Lambda&& lambda)
 {
+	constexpr uint32_t ROW = BasicBoardState<BoardSize>::EXTENDED_BOARD_SIZE;
 	auto wrapped_lambda =
 	    details::wrap_void_lambda(std::forward<Lambda>(lambda));
 	// right
@@ -50,8 +53,7 @@ void for_each_neighbor(
 		if (wrapped_lambda(right) == BREAK)
 			return;
 	// up
-	if (uint32_t up = cell_idx - BoardState::EXTENDED_BOARD_SIZE;
-	    state.board[up] != Cell::BORDER)
+	if (uint32_t up = cell_idx - ROW; state.board[up] != Cell::BORDER)
 		if (wrapped_lambda(up) == BREAK)
 			return;
 	// left
@@ -59,16 +61,15 @@ void for_each_neighbor(
 		if (wrapped_lambda(left) == BREAK)
 			return;
 	// down
-	if (uint32_t down = cell_idx + BoardState::EXTENDED_BOARD_SIZE;
-	    state.board[down] != Cell::BORDER)
+	if (uint32_t down = cell_idx + ROW; state.board[down] != Cell::BORDER)
 		if (wrapped_lambda(down) == BREAK)
 			return;
 }
 
-template <typename Lambda, typename CVClusterTable>
+template <uint32_t BoardSize, typename Lambda, typename CVClusterTable>
 void for_each_neighbor_cluster(
-    CVClusterTable& table, const BoardState& state, uint32_t cell_idx,
-    Lambda&& lambda)
+    CVClusterTable& table, const BasicBoardState<BoardSize>& state,
+    uint32_t cell_idx, Lambda&& lambda)
 {
 	auto wrapped_lambda =
 	    details::wrap_void_lambda<Cluster&>(std::forward<Lambda>(lambda));
@@ -93,47 +94,106 @@ void for_each_neighbor_cluster(
 
 namespace details
 {
+// Visit marks and stack of a board search. A cell is visited when its mark
+// equals the current generation, so a new search only has to move to the
+// next generation instead of clearing the marks.
+template <uint32_t BoardSize>
 struct SearchCache
 {
-	static constexpr uint32_t VISIT_BIT = 1U << 31;
+	static constexpr uint32_t MAX_NUM_CELLS =
+	    BasicBoardState<BoardSize>::MAX_NUM_CELLS;
+
 	bool empty() const
 	{
-		return top_index == -1;
+		return size == 0;
 	}
 	uint32_t pop()
 	{
-		assert(top_index >= 0);
-		return cache[top_index--] & (~VISIT_BIT);
+		assert(size > 0);
+		return stack[--size];
 	}
 	void push(uint32_t value)
 	{
-		top_index++;
-		// clear all except VISIT_BIT
-		cache[top_index] &= VISIT_BIT;
-		// store the value in the first 31 bits;
-		cache[top_index] |= value;
+		assert(size < MAX_NUM_CELLS);
+		stack[size++] = uint16_t(value);
 	}
 	bool is_visited(uint32_t index) const
 	{
-		return (cache[index] & VISIT_BIT);
+		return marks[index] == generation;
 	}
 	void mark_visited(uint32_t index)
 	{
-		cache[index] |= VISIT_BIT;
+		marks[index] = generation;
 	}
 	void mark_unvisited(uint32_t index)
 	{
-		cache[index] &= ~(VISIT_BIT);
+		marks[index] = 0;
 	}
-	uint32_t cache[BoardState::MAX_NUM_CELLS] = {};
-	int32_t top_index = -1;
+	// forgets the previous search in O(1)
+	void reset()
+	{
+		size = 0;
+		// generation 0 is never current, so that zeroed marks are unvisited
+		if (++generation == 0)
+		{
+			marks.fill(0);
+			generation = 1;
+		}
+	}
+
+	std::array<uint32_t, MAX_NUM_CELLS> marks = {};
+	std::array<uint16_t, MAX_NUM_CELLS> stack;
+	uint32_t size = 0;
+	uint32_t generation = 0;
+	bool in_use = false;
 };
 } // namespace details
 
-template <typename Lambda>
-void for_each_cell(const BoardState& state, uint32_t root, Lambda&& lambda)
+// The calling thread's search cache, reset for a new search when acquired
+// and released at the end of the scope. All the searches of a thread share
+// it, so a search can't start another one of the same board size.
+template <uint32_t BoardSize>
+class LocalSearchCache
 {
-	details::SearchCache search_cache;
+public:
+	LocalSearchCache() : cache(get_thread_cache())
+	{
+		assert(!cache.in_use);
+		cache.in_use = true;
+		cache.reset();
+	}
+	~LocalSearchCache()
+	{
+		cache.in_use = false;
+	}
+	LocalSearchCache(const LocalSearchCache&) = delete;
+	LocalSearchCache& operator=(const LocalSearchCache&) = delete;
+
+	details::SearchCache<BoardSize>& operator*()
+	{
+		return cache;
+	}
+	details::SearchCache<BoardSize>* operator->()
+	{
+		return &cache;
+	}
+
+private:
+	static details::SearchCache<BoardSize>& get_thread_cache()
+	{
+		thread_local details::SearchCache<BoardSize> thread_cache;
+		return thread_cache;
+	}
+
+	details::SearchCache<BoardSize>& cache;
+};
+
+template <uint32_t BoardSize, typename Lambda>
+void for_each_cell(
+    const BasicBoardState<BoardSize>& state, uint32_t root, Lambda&& lambda)
+{
+	LocalSearchCache<BoardSize> local_cache;
+	auto& search_cache = *local_cache;
 	search_cache.push(root);
 	search_cache.mark_visited(root);
 
@@ -153,9 +213,10 @@ void for_each_cell(const BoardState& state, uint32_t root, Lambda&& lambda)
 	}
 }
 
-template <typename Lambda>
+template <uint32_t BoardSize, typename Lambda>
 void for_each_cluster_cell(
-    const Cluster& cluster, const BoardState& state, Lambda&& lambda)
+    const Cluster& cluster, const BasicBoardState<BoardSize>& state,
+    Lambda&& lambda)
 {
 	auto wrapped_lambda = details::wrap_void_lambda<uint32_t, EXPAND>(
 	    std::forward<Lambda>(lambda));
@@ -168,8 +229,48 @@ void for_each_cluster_cell(
 	});
 }
 
-template <typename Lambda>
-void for_each_empty_cell(const BoardState& state, Lambda&& lambda)
+// same as above, walking the cluster's stones list instead of searching the
+// board
+template <uint32_t BoardSize, typename Liberties, typename Lambda>
+void for_each_cluster_cell(
+    const BasicClusterTable<BoardSize, Liberties>& table,
+    const Cluster& cluster, Lambda&& lambda)
+{
+	auto wrapped_lambda =
+	    details::wrap_void_lambda<uint32_t>(std::forward<Lambda>(lambda));
+	const uint32_t root = cluster.parent_idx;
+	uint32_t idx = root;
+	do
+	{
+		// read the next stone first, so that lambda can change the cell
+		uint32_t next_idx = table.next_stone[idx];
+		if (wrapped_lambda(idx) == BREAK)
+			return;
+		idx = next_idx;
+	} while (idx != root);
+}
+
+template <uint32_t BoardSize, typename Lambda>
+void for_each_cell(const BasicBitboard<BoardSize>& bitboard, Lambda&& lambda)
+{
+	auto wrapped_lambda =
+	    details::wrap_void_lambda<uint32_t>(std::forward<Lambda>(lambda));
+	using Words = BasicBitboard<BoardSize>;
+	for (uint32_t i = 0; i < Words::NUM_WORDS; i++)
+	{
+		for (uint64_t word = bitboard.words[i]; word != 0; word &= word - 1)
+		{
+			uint32_t idx =
+			    i * Words::WORD_SIZE + details::count_trailing_zeros(word);
+			if (wrapped_lambda(idx) == BREAK)
+				return;
+		}
+	}
+}
+
+template <uint32_t BoardSize, typename Lambda>
+void for_each_empty_cell(
+    const BasicBoardState<BoardSize>& state, Lambda&& lambda)
 {
 	auto wrapped_lambda =
 	    details::wrap_void_lambda<uint32_t>(std::forward<Lambda>(lambda));
@@ -181,23 +282,153 @@ void for_each_empty_cell(const BoardState& state, Lambda&& lambda)
 	}
 }
 
+// same as above, using the empty cells list of the game state instead of
+// scanning the board
+template <uint32_t BoardSize, typename Liberties, typename Lambda>
+void for_each_empty_cell(
+    const BasicPlayoutState<BoardSize, Liberties>& state, Lambda&& lambda)
+{
+	auto wrapped_lambda =
+	    details::wrap_void_lambda<uint32_t>(std::forward<Lambda>(lambda));
+	const auto& empty_cells = state.empty_cells;
+	for (uint32_t i = 0; i < empty_cells.size; i++)
+	{
+		if (wrapped_lambda(empty_cells.cells[i]) == BREAK)
+			return;
+	}
+}
+
+// Sets the liberties of the cluster in cells
+template <uint32_t BoardSize>
+void mark_liberties(
+    BasicBitboard<BoardSize>& cells,
+    const BasicClusterTable<BoardSize, ExactLiberties>& table,
+    const BasicBoardState<BoardSize>&, const Cluster& cluster)
+{
+	cells |= get_liberties_map(table, cluster);
+}
+
+// same as above, walking the cluster's stones as pseudo liberties don't tell
+// where the liberties are
+template <uint32_t BoardSize>
+void mark_liberties(
+    BasicBitboard<BoardSize>& cells,
+    const BasicClusterTable<BoardSize, PseudoLiberties>& table,
+    const BasicBoardState<BoardSize>& state, const Cluster& cluster)
+{
+	for_each_cluster_cell(table, cluster, [&](uint32_t cell_idx) {
+		for_each_neighbor(state, cell_idx, [&](uint32_t neighbor) {
+			if (is_empty_cell(state, neighbor))
+				cells.set(neighbor);
+		});
+	});
+}
+
+namespace details
+{
+// the cells set in legal_moves are the valid actions of a playout state
+template <uint32_t BoardSize, typename Liberties>
+bool is_valid_legal_move(
+    const BasicPlayoutState<BoardSize, Liberties>&, const Action&)
+{
+	return true;
+}
+
+// a game state also ends with passes past its length limit and forbids
+// repeating a position with positional superko, see is_valid_move
+template <uint32_t BoardSize, typename Liberties>
+bool is_valid_legal_move(
+    const BasicGameState<BoardSize, Liberties>& state, const Action& action)
+{
+	using State = BasicGameState<BoardSize, Liberties>;
+	if (state.move_history.size >= State::MAX_NUM_MOVES)
+		return false;
+	return !state.positional_superko || !is_superko(state, action);
+}
+} // namespace details
+
 // if there are no actions, calls lambda on pass, otherwise pass is not
-// considered
-template <typename Lambda>
-void for_each_valid_action(const GameState& state, Lambda&& lambda)
+// considered. State is a game state or a playout state.
+template <typename State, typename Lambda>
+void for_each_valid_action(const State& state, Lambda&& lambda)
 {
 	auto wrapped_lambda =
 	    details::wrap_void_lambda<Action&>(std::forward<Lambda>(lambda));
 	Action action;
 	action.player_index = state.player_turn;
-	for_each_empty_cell(state.board_state, [&](auto pos) {
+	for_each_cell(state.legal_moves[action.player_index], [&](uint32_t pos) {
 		action.pos = pos;
-		if (is_valid_move(state.cluster_table, state.board_state, action))
+		if (details::is_valid_legal_move(state, action))
 			return wrapped_lambda(action);
 		return CONTINUE;
 	});
 }
 
+// Same as for_each_valid_action, skipping the cells that look like eyes of
+// the player to move, see is_eye_like. Calls lambda on pass if there is no
+// other action, so that playouts end with two passes.
+template <typename State, typename Lambda>
+void for_each_playout_move(const State& state, Lambda&& lambda)
+{
+	auto wrapped_lambda =
+	    details::wrap_void_lambda<Action&>(std::forward<Lambda>(lambda));
+	bool found_action = false;
+	for_each_valid_action(state, [&](Action& action) {
+		if (is_eye_like(state.board_state, action.pos, action.player_index))
+			return CONTINUE;
+		found_action = true;
+		return wrapped_lambda(action);
+	});
+	if (!found_action)
+	{
+		Action pass = {Action::PASS, state.player_turn};
+		wrapped_lambda(pass);
+	}
+}
+
+// Draws a valid action of the player to move with probability proportional to
+// the pattern weight of its cell, or pass when there is none. The patterns of
+// eye like cells have no weight, as for_each_playout_move skips them. State is
+// a game state or a playout state.
+template <typename State, typename Rng>
+Action sample_weighted_action(const State& state, Rng& rng)
+{
+	constexpr uint32_t MAX_ATTEMPTS = 8;
+	const uint32_t player = state.player_turn;
+	const auto& weights = state.patterns.weights[player];
+	// the empty cells that aren't valid (ko, suicide) are few, so drawing
+	// among all of them until a valid one comes keeps the draw in O(log n)
+	for (uint32_t i = 0; i < MAX_ATTEMPTS && weights.total != 0; i++)
+	{
+		std::uniform_int_distribution<uint32_t> distribution(
+		    0, weights.total - 1);
+		Action action = {weights.find(distribution(rng)), player};
+		if (is_valid_move(state, action))
+			return action;
+	}
+
+	// otherwise draw among the valid actions only
+	uint32_t total = 0;
+	for_each_valid_action(state, [&](const Action& action) {
+		total += weights[action.pos];
+	});
+	Action result = {Action::PASS, player};
+	if (total == 0)
+		return result;
+	std::uniform_int_distribution<uint32_t> distribution(0, total - 1);
+	uint32_t target = distribution(rng);
+	for_each_valid_action(state, [&](const Action& action) {
+		if (target < weights[action.pos])
+		{
+			result = action;
+			return BREAK;
+		}
+		target -= weights[action.pos];
+		return CONTINUE;
+	});
+	return result;
+}
+
 } // namespace engine
 } // namespace go
 
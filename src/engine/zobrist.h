@@ -0,0 +1,66 @@
+#ifndef SRC_ENGINE_ZOBRIST_H_
+#define SRC_ENGINE_ZOBRIST_H_
+
+#include <array>
+#include <stdint.h>
+
+#include "board.h"
+
+namespace go
+{
+namespace engine
+{
+
+namespace details
+{
+constexpr uint64_t splitmix64(uint64_t& seed)
+{
+	uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+constexpr auto make_zobrist_keys()
+{
+	constexpr uint32_t NUM_CELLS =
+	    BasicBoardState<MAX_SUPPORTED_BOARD_SIZE>::MAX_NUM_CELLS;
+	std::array<std::array<uint64_t, NUM_CELLS>, 2> keys{};
+	uint64_t seed = 0x676F736C61796572ULL;
+	for (auto& player_keys : keys)
+		for (auto& key : player_keys)
+			key = splitmix64(seed);
+	return keys;
+}
+} // namespace details
+
+// One random key per (player, cell) pair, the hash of a position is the xor
+// of the keys of all stones on the board. The keys of the largest board cover
+// the cell indices of the smaller ones
+inline constexpr auto ZOBRIST_KEYS = details::make_zobrist_keys();
+
+inline uint64_t zobrist_key(uint32_t player_index, uint32_t cell_idx)
+{
+	return ZOBRIST_KEYS[player_index][cell_idx];
+}
+
+// Hashes the board from scratch, GameState::hash is kept equal to this
+// incrementally
+template <uint32_t BoardSize>
+uint64_t calculate_hash(const BasicBoardState<BoardSize>& state)
+{
+	uint64_t hash = 0;
+	for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS; i++)
+	{
+		if (state.board[i] == Cell::BLACK)
+			hash ^= zobrist_key(0, i);
+		else if (state.board[i] == Cell::WHITE)
+			hash ^= zobrist_key(1, i);
+	}
+	return hash;
+}
+
+} // namespace engine
+} // namespace go
+
+#endif // SRC_ENGINE_ZOBRIST_H_
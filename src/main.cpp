@@ -1,20 +1,97 @@
 #include "SimpleGUI/simplegui.h"
 #include "controller/game.h"
 #include "engine/board.h"
+#include "mcts/mcts.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
 #include <memory>
+#include <string>
 
 using namespace go::engine;
 using namespace go;
+using namespace go::mcts;
 using namespace go::simplegui;
 
-int main()
+static void print_usage(const char* program)
 {
+	std::cerr << "usage: " << program
+	          << " [--tt-mb size] [--pool-size nodes] [--mcts-color color]\n"
+	          << "  --tt-mb size        transposition table size in MB, 0 to "
+	             "disable it (default "
+	          << SearchConfig::DEFAULT_TT_SIZE_MB << ", at most "
+	          << SearchConfig::MAX_TT_SIZE_MB << ")\n"
+	          << "  --pool-size nodes   nodes of the search trees, 32 bytes "
+	             "each (default "
+	          << SearchConfig::DEFAULT_POOL_SIZE << ", at most "
+	          << SearchConfig::MAX_POOL_SIZE << ")\n"
+	          << "  --mcts-color color  black or white, the color played by "
+	             "the engine (default white)\n";
+}
+
+// parses a number from min to max, strtoul alone accepts a sign and wraps
+// negative numbers around
+static bool
+parse_number(const char* text, uint32_t min, uint32_t max, uint32_t& number)
+{
+	if (!std::isdigit(static_cast<unsigned char>(text[0])))
+		return false;
+	char* end = nullptr;
+	errno = 0;
+	unsigned long value = std::strtoul(text, &end, 10);
+	if (errno == ERANGE || *end != '\0' || value < min || value > max)
+		return false;
+	number = uint32_t(value);
+	return true;
+}
+
+// parses black or white as a player index
+static bool parse_color(const std::string& text, uint32_t& player_idx)
+{
+	if (text == "black")
+		player_idx = 0;
+	else if (text == "white")
+		player_idx = 1;
+	else
+		return false;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	SearchConfig config;
+	uint32_t mcts_player_idx = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		// every option takes a value
+		bool valid = false;
+		if (i + 1 < argc)
+		{
+			const char* value = argv[++i];
+			if (arg == "--tt-mb")
+				valid = parse_number(
+				    value, 0, SearchConfig::MAX_TT_SIZE_MB, config.tt_size_mb);
+			else if (arg == "--pool-size")
+				valid = parse_number(
+				    value, 1, SearchConfig::MAX_POOL_SIZE, config.pool_size);
+			else if (arg == "--mcts-color")
+				valid = parse_color(value, mcts_player_idx);
+		}
+		if (!valid)
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
 	Game game;
 	auto agent = std::make_shared<BoardSimpleGUI>();
-	auto agent2 = std::make_shared<BoardSimpleGUI>();
-	agent->set_player_idx(0);
-	agent2->set_player_idx(1);
-	game.register_agent(agent, 0);
-	game.register_agent(agent2, 1);
+	auto agent2 = std::make_shared<MCTSAgent>(config);
+	agent->set_player_idx(1 - mcts_player_idx);
+	agent2->set_player_idx(mcts_player_idx);
+	game.register_agent(agent, 1 - mcts_player_idx);
+	game.register_agent(agent2, mcts_player_idx);
 	game.main_loop();
 }
@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+#include "engine/interface.h"
+#include "engine/utility.h"
+#include "mcts/mcts.h"
+
+using namespace go;
+using namespace go::engine;
+using namespace go::mcts;
+
+// playouts longer than this are scored as they stand
+static constexpr uint32_t MAX_PLAYOUT_MOVES = BoardState::MAX_NUM_CELLS * 2;
+
+static uint32_t get_number_threads(const SearchConfig& config)
+{
+	if (config.num_threads != 0)
+		return config.num_threads;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Moves the node at from to to, with its children now at first_child
+static void
+move_node(NodePool& pool, uint32_t from, uint32_t to, uint32_t first_child)
+{
+	Node& node = pool[to];
+	if (from != to)
+	{
+		const Node& source = pool[from];
+		node.copy_statistics(source);
+		node.num_children = source.num_children;
+		node.state.store(
+		    source.state.load(std::memory_order_relaxed),
+		    std::memory_order_relaxed);
+	}
+	node.first_child = first_child;
+}
+
+// Moves the subtree of the node to the start of its pool, the node becomes
+// the root and the rest of the pool is freed. The children of a node are
+// allocated after it, so laying out the blocks of children in the order
+// they were allocated moves every node to a lower index, over nodes that
+// are already moved or dropped.
+static void compact_subtree(NodePool& pool, uint32_t node_idx)
+{
+	// the blocks of children of the subtree, as first child and size
+	std::vector<std::pair<uint32_t, uint32_t>> blocks;
+	auto add_children = [&](uint32_t idx) {
+		const Node& node = pool[idx];
+		if (node.is_expanded())
+			blocks.push_back({node.first_child, node.num_children});
+	};
+	add_children(node_idx);
+	for (size_t i = 0; i < blocks.size(); i++)
+		for (uint32_t j = 0; j < blocks[i].second; j++)
+			add_children(blocks[i].first + j);
+	std::sort(blocks.begin(), blocks.end());
+
+	// the new first child of each block, the root goes first
+	std::vector<uint32_t> destinations(blocks.size());
+	uint32_t size = 1;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		destinations[i] = size;
+		size += blocks[i].second;
+	}
+	auto get_first_child = [&](uint32_t idx) {
+		const Node& node = pool[idx];
+		if (!node.is_expanded())
+			return Node::INVALID_INDEX;
+		const auto block = std::lower_bound(
+		    blocks.begin(), blocks.end(), std::make_pair(node.first_child, 0u));
+		assert(block != blocks.end() && block->first == node.first_child);
+		return destinations[size_t(block - blocks.begin())];
+	};
+
+	move_node(pool, node_idx, 0, get_first_child(node_idx));
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		for (uint32_t j = 0; j < blocks[i].second; j++)
+		{
+			const uint32_t from = blocks[i].first + j;
+			move_node(pool, from, destinations[i] + j, get_first_child(from));
+		}
+	}
+	pool.shrink(size);
+}
+
+// Replays the moves of the game on a rollout state, the liberties of its
+// clusters can't be copied from the game state
+static RolloutState get_rollout_state(const GameState& state)
+{
+	RolloutState rollout_state;
+	for (uint32_t i = 0; i < state.move_history.size; i++)
+		make_move(rollout_state, state.move_history[i]);
+	assert(get_position_key(rollout_state) == get_position_key(state));
+	return rollout_state;
+}
+
+MCTSAgent::MCTSAgent(const SearchConfig& config_)
+    : config{config_}, workers(get_number_threads(config_)),
+      started_playouts{0}, number_playouts{0}
+{
+	const uint32_t num_threads = uint32_t(workers.size());
+	const uint32_t num_trees =
+	    config.mode == SearchMode::ROOT_PARALLEL ? num_threads : 1;
+	const uint32_t pool_size = std::max(1u, config.pool_size / num_trees);
+	for (uint32_t i = 0; i < num_trees; i++)
+		pools.push_back(std::make_unique<NodePool>(pool_size));
+	for (uint32_t i = 0; i < num_threads; i++)
+		workers[i].rng.seed(config.seed + i);
+	if (config.tt_size_mb != 0)
+		transposition_table =
+		    std::make_unique<TranspositionTable>(config.tt_size_mb);
+}
+
+MCTSAgent::~MCTSAgent()
+{
+	wait_for_reuse();
+}
+
+uint32_t MCTSAgent::generate_move(const Game& game)
+{
+	return search(game.get_game_state(), get_time_budget(game));
+}
+
+void MCTSAgent::on_move_played(const Action& action)
+{
+	// the subtree is moved while the other player thinks
+	wait_for_reuse();
+	reuse_thread = std::thread([this, action] { reuse_subtrees(action); });
+}
+
+void MCTSAgent::wait_for_reuse()
+{
+	if (reuse_thread.joinable())
+		reuse_thread.join();
+}
+
+void MCTSAgent::reuse_subtrees(const Action& action)
+{
+	for (uint32_t i = 0; i < pools.size(); i++)
+	{
+		NodePool& pool = *pools[i];
+		uint32_t kept_idx = Node::INVALID_INDEX;
+		if (pool.get_size() != 0 && pool[ROOT].is_expanded())
+		{
+			const Node& root = pool[ROOT];
+			for (uint32_t j = 0; j < root.num_children; j++)
+				if (pool[root.first_child + j].move == action.pos)
+					kept_idx = root.first_child + j;
+		}
+		if (kept_idx == Node::INVALID_INDEX)
+			pool.clear();
+		else
+			compact_subtree(pool, kept_idx);
+	}
+}
+
+std::chrono::milliseconds MCTSAgent::get_time_budget(const Game& game) const
+{
+	auto allowed_time = game.get_allowed_time(get_player_idx());
+	auto elapsed_time = game.get_elapsed_time(get_player_idx());
+	if (elapsed_time >= allowed_time)
+		return std::chrono::milliseconds::zero();
+	return (allowed_time - elapsed_time) / MOVES_TO_PLAN;
+}
+
+uint32_t MCTSAgent::search(
+    const GameState& state, std::chrono::milliseconds budget)
+{
+	wait_for_reuse();
+	// the budget is for searching, the time waited for the kept subtree to
+	// be moved isn't taken from it
+	auto deadline = std::chrono::steady_clock::now() + budget;
+	const uint64_t key = get_position_key(state);
+	for (uint32_t i = 0; i < pools.size(); i++)
+	{
+		NodePool& pool = *pools[i];
+		// a tree kept from the previous moves must be of this position
+		if (pool.get_size() == 0 || pool[ROOT].key != key)
+		{
+			pool.clear();
+			pool.allocate(1);
+			pool[ROOT].move = Action::PASS;
+			pool[ROOT].key = key;
+		}
+		if (pool[ROOT].is_expanded())
+			remove_superko_children(pool, state);
+		else
+			expand(pool, ROOT, state);
+	}
+	for (uint32_t i = 0; i < workers.size(); i++)
+		workers[i].pool = pools[i % pools.size()].get();
+	// the entries of the positions left behind by the game would otherwise
+	// keep the new ones out
+	if (transposition_table)
+		transposition_table->new_search();
+
+	started_playouts = 0;
+	number_playouts = 0;
+	const RolloutState root_state = get_rollout_state(state);
+	// the calling thread is the first worker
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < workers.size(); i++)
+		threads.emplace_back(
+		    [&, i] { run_worker(root_state, deadline, workers[i]); });
+	run_worker(root_state, deadline, workers[0]);
+	for (std::thread& thread : threads)
+		thread.join();
+	merge_root_statistics();
+	return get_best_move();
+}
+
+void MCTSAgent::run_worker(
+    const RolloutState& root_state,
+    std::chrono::steady_clock::time_point deadline, Worker& worker)
+{
+	do
+	{
+		if (config.max_playouts != 0 &&
+		    started_playouts.fetch_add(1) >= config.max_playouts)
+			break;
+		run_playout(root_state, worker);
+		number_playouts++;
+	} while (std::chrono::steady_clock::now() < deadline);
+}
+
+void MCTSAgent::run_playout(const RolloutState& root_state, Worker& worker)
+{
+	NodePool& pool = *worker.pool;
+	RolloutState state = root_state;
+	worker.path.clear();
+	worker.path.push_back(ROOT);
+	pool[ROOT].visits.fetch_add(1, std::memory_order_relaxed);
+
+	// selection, the tree only has valid moves so make_move can't fail
+	uint32_t node_idx = ROOT;
+	while (pool[node_idx].is_expanded() && pool[node_idx].num_children != 0)
+	{
+		node_idx = select_child(pool, node_idx);
+		visit(node_idx, state, worker);
+	}
+
+	// expansion of the leaf, once it has been visited before
+	if (pool[node_idx].visits.load(std::memory_order_relaxed) > 1 &&
+	    !is_terminal_state(state) && expand(pool, node_idx, state))
+	{
+		node_idx = select_child(pool, node_idx);
+		visit(node_idx, state, worker);
+	}
+
+	const uint32_t root_player = root_state.player_turn;
+	const float black_result = rollout(state, worker.rng);
+
+	// the node at depth d was reached by a move of the root player if d is
+	// odd, the root itself has no move
+	for (uint32_t depth = 0; depth < worker.path.size(); depth++)
+	{
+		Node& node = pool[worker.path[depth]];
+		const uint32_t player = root_player ^ ((depth + 1) & 1);
+		const float result = player == 0 ? black_result : 1 - black_result;
+		node.add_wins(result);
+		if (transposition_table)
+			transposition_table->update(
+			    node.key.load(std::memory_order_relaxed), result);
+	}
+}
+
+void MCTSAgent::visit(uint32_t node_idx, RolloutState& state, Worker& worker)
+{
+	Node& node = (*worker.pool)[node_idx];
+	node.visits.fetch_add(1, std::memory_order_relaxed);
+	make_move(state, {node.move, state.player_turn});
+	// threads visiting the node at once store the same key
+	if (node.key.load(std::memory_order_relaxed) == 0)
+		node.key.store(get_position_key(state), std::memory_order_relaxed);
+	worker.path.push_back(node_idx);
+}
+
+uint32_t
+MCTSAgent::select_child(const NodePool& pool, uint32_t node_idx) const
+{
+	const Node& node = pool[node_idx];
+	const uint32_t node_visits = node.visits.load(std::memory_order_relaxed);
+	const float log_visits = std::log(float(node_visits + 1));
+	uint32_t best_child = node.first_child;
+	float best_value = -1;
+	for (uint32_t i = 0; i < node.num_children; i++)
+	{
+		const uint32_t child_idx = node.first_child + i;
+		const Node& child = pool[child_idx];
+		const uint32_t child_visits =
+		    child.visits.load(std::memory_order_relaxed);
+		// unvisited children are tried first
+		if (child_visits == 0)
+			return child_idx;
+		// the visits of the playouts in progress count as losses
+		const float visits = float(child_visits);
+		const float value =
+		    get_mean_result(child, child_visits) +
+		    config.exploration * std::sqrt(log_visits / visits);
+		if (value > best_value)
+		{
+			best_value = value;
+			best_child = child_idx;
+		}
+	}
+	return best_child;
+}
+
+// The children of a kept root come from a playout state, which ignores
+// superko. Those that aren't valid in the game are removed, keeping the
+// order of the others.
+void MCTSAgent::remove_superko_children(NodePool& pool, const GameState& state)
+{
+	Node& root = pool[ROOT];
+	uint16_t num_children = 0;
+	for (uint32_t i = 0; i < root.num_children; i++)
+	{
+		const Node& child = pool[root.first_child + i];
+		if (!is_valid_move(state, {child.move, state.player_turn}))
+			continue;
+		move_node(
+		    pool, root.first_child + i, root.first_child + num_children,
+		    child.first_child);
+		num_children++;
+	}
+	root.num_children = num_children;
+}
+
+// The mean result of the node's position over all the paths that reach it,
+// if the transposition table has more playouts of it than the node
+float MCTSAgent::get_mean_result(const Node& node, uint32_t visits) const
+{
+	if (transposition_table)
+	{
+		const TranspositionTable::Entry* entry = transposition_table->find(
+		    node.key.load(std::memory_order_relaxed));
+		if (entry != nullptr)
+		{
+			const uint32_t entry_visits =
+			    entry->visits.load(std::memory_order_relaxed);
+			if (entry_visits > visits)
+				return entry->wins.load(std::memory_order_relaxed) /
+				       float(entry_visits);
+		}
+	}
+	return node.wins.load(std::memory_order_relaxed) / float(visits);
+}
+
+// Adds a child for each valid move and one for pass. The children are
+// published by the release store of the node's state.
+template <typename State>
+bool MCTSAgent::expand(NodePool& pool, uint32_t node_idx, const State& state)
+{
+	Node& node = pool[node_idx];
+	Node::State expected = Node::LEAF;
+	if (!node.state.compare_exchange_strong(
+	        expected, Node::EXPANDING, std::memory_order_acquire))
+		return false;
+
+	std::array<uint32_t, BoardState::MAX_NUM_CELLS + 1> moves;
+	uint32_t num_moves = 0;
+	for_each_valid_action(state, [&](const Action& action) {
+		moves[num_moves++] = action.pos;
+	});
+	moves[num_moves++] = Action::PASS;
+
+	const uint32_t first_child = pool.allocate(num_moves);
+	if (first_child == Node::INVALID_INDEX)
+	{
+		node.state.store(Node::LEAF, std::memory_order_relaxed);
+		return false;
+	}
+	for (uint32_t i = 0; i < num_moves; i++)
+		pool[first_child + i].move = moves[i];
+	node.first_child = first_child;
+	node.num_children = uint16_t(num_moves);
+	node.state.store(Node::EXPANDED, std::memory_order_release);
+	return true;
+}
+
+float MCTSAgent::rollout(RolloutState& state, std::mt19937& rng)
+{
+	for (uint32_t i = 0; i < MAX_PLAYOUT_MOVES && !is_terminal_state(state);
+	     i++)
+		make_move(state, sample_weighted_action(state, rng));
+
+	Player& black_player = state.players[0];
+	Player& white_player = state.players[1];
+	calculate_score(state.board_state, black_player, white_player);
+	if (black_player.total_score > white_player.total_score)
+		return 1;
+	if (black_player.total_score < white_player.total_score)
+		return 0;
+	return 0.5f;
+}
+
+// Called once the threads are done, as the trees only count their own
+// playouts a kept tree needs nothing taken back before the next search
+void MCTSAgent::merge_root_statistics()
+{
+	// index of each move in root_statistics, pass goes last
+	constexpr uint32_t PASS_SLOT = BoardState::MAX_NUM_CELLS;
+	std::array<uint32_t, BoardState::MAX_NUM_CELLS + 1> slots;
+	slots.fill(UINT32_MAX);
+	root_statistics.clear();
+	for (const auto& pool : pools)
+	{
+		const Node& root = (*pool)[ROOT];
+		if (!root.is_expanded())
+			continue;
+		for (uint32_t i = 0; i < root.num_children; i++)
+		{
+			const Node& child = (*pool)[root.first_child + i];
+			uint32_t& slot = slots[is_pass({child.move, 0}) ? PASS_SLOT
+			                                                : child.move];
+			if (slot == UINT32_MAX)
+			{
+				slot = uint32_t(root_statistics.size());
+				root_statistics.push_back({child.move, 0, 0});
+			}
+			root_statistics[slot].visits +=
+			    child.visits.load(std::memory_order_relaxed);
+			root_statistics[slot].wins +=
+			    child.wins.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+uint32_t MCTSAgent::get_best_move() const
+{
+	uint32_t best_move = Action::PASS;
+	uint32_t best_visits = 0;
+	for (const MoveStatistics& statistics : root_statistics)
+	{
+		if (statistics.visits > best_visits)
+		{
+			best_visits = statistics.visits;
+			best_move = statistics.move;
+		}
+	}
+	return best_move;
+}
@@ -0,0 +1,174 @@
+#ifndef SRC_MCTS_MCTS_H_
+#define SRC_MCTS_MCTS_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <stdint.h>
+#include <vector>
+
+#include "controller/agent.h"
+#include "controller/game.h"
+#include "engine/board.h"
+#include "mcts/node.h"
+#include "mcts/transposition.h"
+
+namespace go
+{
+namespace mcts
+{
+
+enum class SearchMode
+{
+	// the threads search one shared tree
+	TREE_PARALLEL,
+	// each thread searches its own tree, their root statistics are merged
+	// at the end of the search
+	ROOT_PARALLEL
+};
+
+struct SearchConfig
+{
+	// 32 bytes per node, the default takes 128MB and the maximum 4GB
+	static constexpr uint32_t DEFAULT_POOL_SIZE = 1 << 22;
+	static constexpr uint32_t MAX_POOL_SIZE = 1 << 27;
+	static constexpr uint32_t DEFAULT_TT_SIZE_MB = 64;
+	static constexpr uint32_t MAX_TT_SIZE_MB = 4096;
+
+	// nodes of all the trees, up to MAX_POOL_SIZE
+	uint32_t pool_size = DEFAULT_POOL_SIZE;
+	// stops the search after this many playouts, 0 to only stop on time
+	uint32_t max_playouts = 0;
+	// weight of the exploration term of UCT
+	float exploration = 1.0f;
+	uint32_t seed = 0;
+	// threads searching the tree, 0 for one per hardware thread
+	uint32_t num_threads = 0;
+	// with ROOT_PARALLEL, the pool is split evenly between the trees
+	SearchMode mode = SearchMode::TREE_PARALLEL;
+	// size of the transposition table shared by the threads, 0 to search
+	// without one, up to MAX_TT_SIZE_MB
+	uint32_t tt_size_mb = DEFAULT_TT_SIZE_MB;
+};
+
+// The state the tree is descended and the playouts are run on. Pseudo
+// liberties are enough to play by the rules and make it cheaper to copy at
+// the start of each playout than the game state.
+using RolloutState = engine::BasicPlayoutState<
+    engine::DEFAULT_BOARD_SIZE, engine::PseudoLiberties>;
+
+// Playouts through a move of the root, summed over the trees
+struct MoveStatistics
+{
+	uint32_t move;
+	uint32_t visits;
+	float wins;
+};
+
+// Plays the move whose subtree got the most playouts of a UCT search. The
+// tree lives in a node pool of fixed capacity: when it is full, leaves are no
+// longer expanded and the search goes on with playouts. When a move is
+// played, the subtree of the new position is kept for the next search.
+// With several threads, they either search the same tree and are spread
+// across its branches by virtual losses, or search a tree each, see
+// SearchMode. Nodes of the same position, reached by different move orders,
+// share their statistics through the transposition table.
+class MCTSAgent : public Agent
+{
+public:
+	explicit MCTSAgent(const SearchConfig& config_ = SearchConfig());
+	virtual ~MCTSAgent() override;
+
+	virtual uint32_t generate_move(const Game& game) override;
+	// moves the subtree of the move to the start of the pool on a
+	// background thread, the next search waits for it
+	virtual void on_move_played(const engine::Action& action) override;
+
+	// searches the state until the time budget or the playout limit is
+	// reached, returns the cell to play or engine::Action::PASS
+	uint32_t
+	search(const engine::GameState& state, std::chrono::milliseconds budget);
+
+	// the tree of a thread, there is a single one with TREE_PARALLEL
+	const NodePool& get_pool(uint32_t tree = 0) const
+	{
+		return *pools[tree];
+	}
+	uint32_t get_number_trees() const
+	{
+		return uint32_t(pools.size());
+	}
+	uint32_t get_number_playouts() const
+	{
+		return number_playouts;
+	}
+	// the root moves of the last search, summed over the trees
+	const std::vector<MoveStatistics>& get_root_statistics() const
+	{
+		return root_statistics;
+	}
+	// nullptr if the agent searches without one
+	const TranspositionTable* get_transposition_table() const
+	{
+		return transposition_table.get();
+	}
+
+private:
+	// the game's remaining time is split evenly between this many moves
+	static constexpr uint32_t MOVES_TO_PLAN = 40;
+	static constexpr uint32_t ROOT = 0;
+
+	// the state of a search thread
+	struct Worker
+	{
+		// the tree searched by the thread
+		NodePool* pool;
+		std::mt19937 rng;
+		// nodes from the root to the current leaf
+		std::vector<uint32_t> path;
+	};
+
+	void wait_for_reuse();
+	// moves the root of each tree to the child of the action, or empties
+	// the tree if there is none
+	void reuse_subtrees(const engine::Action& action);
+	void
+	remove_superko_children(NodePool& pool, const engine::GameState& state);
+	std::chrono::milliseconds get_time_budget(const Game& game) const;
+	void run_worker(
+	    const RolloutState& root_state,
+	    std::chrono::steady_clock::time_point deadline, Worker& worker);
+	void run_playout(const RolloutState& root_state, Worker& worker);
+	// goes down to the child and counts the visit
+	void visit(uint32_t node_idx, RolloutState& state, Worker& worker);
+	uint32_t select_child(const NodePool& pool, uint32_t node_idx) const;
+	float get_mean_result(const Node& node, uint32_t visits) const;
+	// returns false if another thread is expanding the node or the pool is
+	// full
+	template <typename State>
+	bool expand(NodePool& pool, uint32_t node_idx, const State& state);
+	// plays random moves until the game ends, returns the result for black,
+	// 1 for a win, 0 for a loss and 0.5 for a draw
+	float rollout(RolloutState& state, std::mt19937& rng);
+	// sums the statistics of the root children of every tree by move
+	void merge_root_statistics();
+	uint32_t get_best_move() const;
+
+	SearchConfig config;
+	// a single pool shared by the threads, or one per thread
+	std::vector<std::unique_ptr<NodePool>> pools;
+	std::thread reuse_thread;
+	std::vector<Worker> workers;
+	std::vector<MoveStatistics> root_statistics;
+	std::unique_ptr<TranspositionTable> transposition_table;
+	// playouts started by the current search, some may not be finished
+	std::atomic<uint32_t> started_playouts;
+	std::atomic<uint32_t> number_playouts;
+};
+
+} // namespace mcts
+} // namespace go
+
+#endif // SRC_MCTS_MCTS_H_
@@ -0,0 +1,161 @@
+#ifndef SRC_MCTS_NODE_H_
+#define SRC_MCTS_NODE_H_
+
+#include <assert.h>
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+namespace go
+{
+namespace mcts
+{
+
+// A position of the search tree, reached by playing move from its parent.
+// The children of a node are contiguous in the pool. The statistics are
+// atomic so that search threads can share the tree without locks.
+struct Node
+{
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	enum State : uint8_t
+	{
+		LEAF,
+		// a thread is adding the children
+		EXPANDING,
+		// first_child and num_children are set, and never change again
+		EXPANDED
+	};
+
+	// key of the position in the transposition table, 0 until the node is
+	// first visited
+	std::atomic<uint64_t> key;
+	// cell played to reach the node, or engine::Action::PASS
+	uint32_t move;
+	// playouts through the node, counted when a thread goes down the node
+	// and before the playout is scored, as a virtual loss
+	std::atomic<uint32_t> visits;
+	// playouts won by the player who played move, a draw counts as half
+	std::atomic<float> wins;
+	uint32_t first_child;
+	uint16_t num_children;
+	std::atomic<State> state;
+
+	Node()
+	    : key{0}, move{0}, visits{0}, wins{0}, first_child{INVALID_INDEX},
+	      num_children{0}, state{LEAF}
+	{
+	}
+
+	void reset()
+	{
+		key.store(0, std::memory_order_relaxed);
+		move = 0;
+		visits.store(0, std::memory_order_relaxed);
+		wins.store(0, std::memory_order_relaxed);
+		first_child = INVALID_INDEX;
+		num_children = 0;
+		state.store(LEAF, std::memory_order_relaxed);
+	}
+
+	// copies the move and statistics of other, the children are left out
+	void copy_statistics(const Node& other)
+	{
+		reset();
+		key.store(
+		    other.key.load(std::memory_order_relaxed),
+		    std::memory_order_relaxed);
+		move = other.move;
+		visits.store(
+		    other.visits.load(std::memory_order_relaxed),
+		    std::memory_order_relaxed);
+		wins.store(
+		    other.wins.load(std::memory_order_relaxed),
+		    std::memory_order_relaxed);
+	}
+
+	bool is_expanded() const
+	{
+		return state.load(std::memory_order_acquire) == EXPANDED;
+	}
+
+	void add_wins(float value)
+	{
+		float expected = wins.load(std::memory_order_relaxed);
+		while (!wins.compare_exchange_weak(
+		    expected, expected + value, std::memory_order_relaxed))
+			;
+	}
+};
+
+// Fixed capacity arena of nodes, allocated once so that the memory used by
+// the search doesn't grow during a game. Nodes are addressed by index and are
+// all freed at once by clear. allocate may be called by several threads,
+// clear may not.
+class NodePool
+{
+public:
+	explicit NodePool(uint32_t capacity) : nodes(capacity), size{0}
+	{
+	}
+
+	// allocates count contiguous nodes and returns the index of the first
+	// one, or Node::INVALID_INDEX if the pool is full
+	uint32_t allocate(uint32_t count)
+	{
+		const uint32_t capacity = get_capacity();
+		uint32_t first = size.load(std::memory_order_relaxed);
+		do
+		{
+			if (count > capacity - first)
+				return Node::INVALID_INDEX;
+		} while (!size.compare_exchange_weak(
+		    first, first + count, std::memory_order_relaxed));
+		for (uint32_t i = first; i < first + count; i++)
+			nodes[i].reset();
+		return first;
+	}
+
+	void clear()
+	{
+		size.store(0, std::memory_order_relaxed);
+	}
+
+	// frees the nodes from new_size on
+	void shrink(uint32_t new_size)
+	{
+		assert(new_size <= get_size());
+		size.store(new_size, std::memory_order_relaxed);
+	}
+
+	Node& operator[](uint32_t idx)
+	{
+		assert(idx < get_size());
+		return nodes[idx];
+	}
+
+	const Node& operator[](uint32_t idx) const
+	{
+		assert(idx < get_size());
+		return nodes[idx];
+	}
+
+	uint32_t get_size() const
+	{
+		return size.load(std::memory_order_relaxed);
+	}
+
+	uint32_t get_capacity() const
+	{
+		return uint32_t(nodes.size());
+	}
+
+private:
+	std::vector<Node> nodes;
+	std::atomic<uint32_t> size;
+};
+
+} // namespace mcts
+} // namespace go
+
+#endif // SRC_MCTS_NODE_H_
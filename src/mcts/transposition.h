@@ -0,0 +1,203 @@
+#ifndef SRC_MCTS_TRANSPOSITION_H_
+#define SRC_MCTS_TRANSPOSITION_H_
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "engine/board.h"
+
+namespace go
+{
+namespace mcts
+{
+
+// Zobrist hashes only cover the stones, positions with the same stones also
+// differ by the player to move and the ko cell
+template <uint32_t BoardSize, typename Liberties>
+uint64_t
+get_position_key(const engine::BasicPlayoutState<BoardSize, Liberties>& state)
+{
+	constexpr std::array<uint64_t, 2> SIDE_KEYS = {
+	    0x5A3C96E1F00DB1E5ULL, 0xC3A5C85C97CB3127ULL};
+	constexpr uint64_t KO_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+	return state.hash ^ SIDE_KEYS[state.player_turn] ^
+	       (uint64_t(state.board_state.ko) * KO_MULTIPLIER);
+}
+
+// Playout statistics of positions, shared by every path of the search that
+// reaches them. Entries are grouped in buckets of one cache line, a position
+// goes to the bucket given by the low bits of its key and replaces the least
+// visited entry there. Entries are kept from one search to the next, but
+// those the current search hasn't updated are replaced first, see
+// new_search.
+//
+// The table has no locks: the fields of an entry are updated by separate
+// atomic operations, so a result added while another thread replaces the
+// entry may be lost or counted for the new position. Both only skew the
+// statistics slightly.
+class TranspositionTable
+{
+public:
+	struct Entry
+	{
+		// key of the position, with the low bits, which are those of the
+		// bucket, replaced by the generation that last updated it. 0 for an
+		// empty entry.
+		std::atomic<uint64_t> key;
+		std::atomic<uint32_t> visits;
+		// playouts won by the player who moved into the position
+		std::atomic<float> wins;
+	};
+
+	static constexpr uint32_t BUCKET_SIZE = 4;
+	static constexpr uint32_t GENERATION_BITS = 8;
+	static constexpr uint64_t GENERATION_MASK =
+	    (uint64_t(1) << GENERATION_BITS) - 1;
+
+	// the table takes size_mb megabytes, rounded down to a power of two
+	// number of buckets
+	explicit TranspositionTable(uint32_t size_mb)
+	    : buckets(get_number_buckets(size_mb)), mask{buckets.size() - 1},
+	      generation{1}
+	{
+		clear();
+	}
+
+	// starts the generation of the next search, the entries of the previous
+	// ones are still found but are the first to be replaced. Must not be
+	// called during a search.
+	void new_search()
+	{
+		// 0 is left to empty entries
+		generation = generation % GENERATION_MASK + 1;
+	}
+
+	// the entry of the position, or nullptr if it isn't in the table
+	const Entry* find(uint64_t key) const
+	{
+		if (key == 0)
+			return nullptr;
+		for (const Entry& entry : get_bucket(key).entries)
+			if (is_entry_of(entry.key.load(std::memory_order_acquire), key))
+				return &entry;
+		return nullptr;
+	}
+
+	// adds a playout result to the entry of the position, which is created
+	// if the position isn't in the table
+	void update(uint64_t key, float wins)
+	{
+		if (key == 0)
+			return;
+		const uint64_t tagged_key = (key & ~GENERATION_MASK) | generation;
+		Bucket& bucket = get_bucket(key);
+		Entry* victim = &bucket.entries[0];
+		// entries of older generations go before the least visited ones
+		uint64_t victim_priority = UINT64_MAX;
+		for (Entry& entry : bucket.entries)
+		{
+			uint64_t entry_key = entry.key.load(std::memory_order_acquire);
+			if (is_entry_of(entry_key, key))
+			{
+				// a failed exchange means another thread already tagged it
+				if (entry_key != tagged_key)
+					entry.key.compare_exchange_strong(
+					    entry_key, tagged_key, std::memory_order_acq_rel);
+				entry.visits.fetch_add(1, std::memory_order_relaxed);
+				add_wins(entry, wins);
+				return;
+			}
+			const uint64_t is_current =
+			    (entry_key & GENERATION_MASK) == generation;
+			const uint64_t priority =
+			    is_current << 32 |
+			    entry.visits.load(std::memory_order_relaxed);
+			if (priority < victim_priority)
+			{
+				victim = &entry;
+				victim_priority = priority;
+			}
+		}
+
+		// another thread replacing the victim first takes precedence
+		uint64_t victim_key = victim->key.load(std::memory_order_relaxed);
+		if (!victim->key.compare_exchange_strong(
+		        victim_key, tagged_key, std::memory_order_acq_rel))
+			return;
+		victim->visits.store(1, std::memory_order_relaxed);
+		victim->wins.store(wins, std::memory_order_relaxed);
+	}
+
+	// must not be called during a search
+	void clear()
+	{
+		for (Bucket& bucket : buckets)
+		{
+			for (Entry& entry : bucket.entries)
+			{
+				entry.key.store(0, std::memory_order_relaxed);
+				entry.visits.store(0, std::memory_order_relaxed);
+				entry.wins.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	size_t get_number_buckets() const
+	{
+		return buckets.size();
+	}
+
+private:
+	struct alignas(64) Bucket
+	{
+		std::array<Entry, BUCKET_SIZE> entries;
+	};
+
+	static size_t get_number_buckets(uint32_t size_mb)
+	{
+		const size_t size = size_t(size_mb) << 20;
+		// the low bits of the keys that hold the generation are those of the
+		// bucket, so the table still tells all the keys apart
+		size_t number_buckets = GENERATION_MASK + 1;
+		while (number_buckets * 2 * sizeof(Bucket) <= size)
+			number_buckets *= 2;
+		return number_buckets;
+	}
+
+	static bool is_entry_of(uint64_t entry_key, uint64_t key)
+	{
+		return entry_key != 0 &&
+		       ((entry_key ^ key) & ~GENERATION_MASK) == 0;
+	}
+
+	static void add_wins(Entry& entry, float wins)
+	{
+		float expected = entry.wins.load(std::memory_order_relaxed);
+		while (!entry.wins.compare_exchange_weak(
+		    expected, expected + wins, std::memory_order_relaxed))
+			;
+	}
+
+	Bucket& get_bucket(uint64_t key)
+	{
+		return buckets[key & mask];
+	}
+
+	const Bucket& get_bucket(uint64_t key) const
+	{
+		return buckets[key & mask];
+	}
+
+	std::vector<Bucket> buckets;
+	size_t mask;
+	// tag of the entries updated by the current search, never 0
+	uint64_t generation;
+};
+
+} // namespace mcts
+} // namespace go
+
+#endif // SRC_MCTS_TRANSPOSITION_H_
@@ -0,0 +1,50 @@
+#include "includes/catch.hpp"
+
+#include <random>
+
+#include "engine/bitboard.h"
+#include "engine/board.h"
+#include "engine/cluster.h"
+#include "engine/interface.h"
+#include "engine/liberties.h"
+#include "helpers.h"
+
+using namespace go::engine;
+
+TEST_CASE("bitboard queries match the board search", "[bitboard]")
+{
+	std::mt19937 rng(7);
+	GameState state;
+	for (uint32_t move = 0; move < 400; move++)
+	{
+		REQUIRE(make_move(state, random_action(state, rng)));
+		if (move % 25 != 0)
+			continue;
+
+		BitboardState bitboard_state(state.board_state);
+		const BoardState& board_state = state.board_state;
+		for (uint32_t i = 0; i < BoardState::MAX_NUM_CELLS; i++)
+		{
+			Cell cell = board_state.board[i];
+			if (cell != Cell::BLACK && cell != Cell::WHITE)
+				continue;
+			REQUIRE(
+			    count_liberties(bitboard_state, i) ==
+			    count_liberties(board_state, i));
+
+			uint32_t cluster_size = 0;
+			for_each_cluster_cell(bitboard_state, i, [&](uint32_t idx) {
+				REQUIRE(board_state.board[idx] == cell);
+				cluster_size++;
+			});
+			REQUIRE(cluster_size == get_cluster(state.cluster_table, i).size);
+		}
+
+		Player black = state.players[0], white = state.players[1];
+		Player bitboard_black = black, bitboard_white = white;
+		calculate_score(board_state, black, white);
+		calculate_score(bitboard_state, bitboard_black, bitboard_white);
+		REQUIRE(black.total_score == bitboard_black.total_score);
+		REQUIRE(white.total_score == bitboard_white.total_score);
+	}
+}
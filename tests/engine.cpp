@@ -0,0 +1,598 @@
+#include "includes/catch.hpp"
+
+#include <random>
+#include <vector>
+
+#include "engine/board.h"
+#include "engine/cluster.h"
+#include "engine/interface.h"
+#include "engine/liberties.h"
+#include "engine/utility.h"
+#include "engine/zobrist.h"
+#include "helpers.h"
+
+using namespace go::engine;
+
+template <uint32_t BoardSize, typename Liberties>
+static void require_same_state(
+    const BasicGameState<BoardSize, Liberties>& a,
+    const BasicGameState<BoardSize, Liberties>& b)
+{
+	REQUIRE(a.board_state.board == b.board_state.board);
+	REQUIRE(a.board_state.ko == b.board_state.ko);
+	REQUIRE(a.hash == b.hash);
+	REQUIRE(a.player_turn == b.player_turn);
+	REQUIRE(a.number_played_moves == b.number_played_moves);
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		REQUIRE(a.players[i].number_alive_stones ==
+		        b.players[i].number_alive_stones);
+		REQUIRE(a.players[i].number_captured_enemies ==
+		        b.players[i].number_captured_enemies);
+	}
+	REQUIRE(a.empty_cells.size == b.empty_cells.size);
+	REQUIRE(a.patterns.codes == b.patterns.codes);
+	REQUIRE(a.atari_clusters.size == b.atari_clusters.size);
+	for (uint32_t i = 0; i < a.atari_clusters.size; i++)
+	{
+		uint32_t root = a.atari_clusters.roots[i];
+		REQUIRE(b.atari_clusters.contains(root));
+		REQUIRE(
+		    a.atari_clusters.liberties[root] ==
+		    b.atari_clusters.liberties[root]);
+	}
+	for (uint32_t i = 0; i < a.empty_cells.size; i++)
+		REQUIRE(is_empty_cell(a.board_state, a.empty_cells.cells[i]));
+	for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS; i++)
+	{
+		Cell cell = a.board_state.board[i];
+		if (cell != Cell::BLACK && cell != Cell::WHITE)
+			continue;
+		REQUIRE(
+		    get_cluster_idx(a.cluster_table, i) ==
+		    get_cluster_idx(b.cluster_table, i));
+		const Cluster& cluster_a = get_cluster(a.cluster_table, i);
+		const Cluster& cluster_b = get_cluster(b.cluster_table, i);
+		REQUIRE(cluster_a.player == cluster_b.player);
+		REQUIRE(cluster_a.size == cluster_b.size);
+		uint32_t cluster_size = 0;
+		for_each_cluster_cell(a.cluster_table, cluster_a, [&](uint32_t idx) {
+			REQUIRE(a.board_state.board[idx] == cell);
+			// stones point to their root directly
+			REQUIRE(
+			    a.cluster_table.clusters[idx].parent_idx ==
+			    get_cluster_idx(a.cluster_table, i));
+			cluster_size++;
+		});
+		REQUIRE(cluster_size == cluster_a.size);
+		REQUIRE(cluster_a.num_liberties == cluster_b.num_liberties);
+		if constexpr (std::is_same_v<Liberties, ExactLiberties>)
+		{
+			REQUIRE(
+			    get_liberties_map(a.cluster_table, cluster_a) ==
+			    get_liberties_map(b.cluster_table, cluster_b));
+		}
+		else
+		{
+			REQUIRE(
+			    a.cluster_table.liberty_sums[cluster_a.parent_idx] ==
+			    b.cluster_table.liberty_sums[cluster_b.parent_idx]);
+			REQUIRE(
+			    a.cluster_table.liberty_square_sums[cluster_a.parent_idx] ==
+			    b.cluster_table.liberty_square_sums[cluster_b.parent_idx]);
+		}
+	}
+}
+
+// every cluster in atari is in the atari list with its liberty, and the
+// patterns are flagged accordingly
+template <uint32_t BoardSize, typename Liberties>
+static void
+require_consistent_ataris(const BasicGameState<BoardSize, Liberties>& state)
+{
+	const auto& table = state.cluster_table;
+	uint32_t num_ataris = 0;
+	for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS; i++)
+	{
+		Cell cell = state.board_state.board[i];
+		if (cell != Cell::BLACK && cell != Cell::WHITE)
+			continue;
+		if (get_cluster_idx(table, i) != i)
+			continue;
+		const Cluster& cluster = table.clusters[i];
+		REQUIRE(
+		    state.atari_clusters.contains(i) == is_in_atari(table, cluster));
+		if (is_in_atari(table, cluster))
+		{
+			REQUIRE(
+			    state.atari_clusters.liberties[i] ==
+			    get_atari_liberty(table, cluster));
+			num_ataris++;
+		}
+	}
+	REQUIRE(state.atari_clusters.size == num_ataris);
+	for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS; i++)
+	{
+		if (state.board_state.board[i] == Cell::BORDER)
+			continue;
+		REQUIRE(state.patterns[i] == calculate_pattern(state, i));
+		for (uint32_t player = 0; player < 2; player++)
+		{
+			uint32_t weight = is_empty_cell(state.board_state, i)
+			                      ? PATTERN_WEIGHTS[player][state.patterns[i]]
+			                      : 0;
+			REQUIRE(state.patterns.weights[player][i] == weight);
+		}
+	}
+}
+
+template <uint32_t BoardSize, typename Liberties>
+static void require_consistent_legal_moves(
+    const BasicGameState<BoardSize, Liberties>& state)
+{
+	for (uint32_t i = 0; i < BasicBoardState<BoardSize>::MAX_NUM_CELLS; i++)
+	{
+		if (state.board_state.board[i] == Cell::BORDER)
+			continue;
+		for (uint32_t player = 0; player < 2; player++)
+		{
+			Action action = {i, player};
+			REQUIRE(
+			    state.legal_moves[player].test(i) ==
+			    is_valid_move(state.cluster_table, state.board_state, action));
+		}
+	}
+}
+
+// Builds the following ko shape, black to capture at (1, 2)
+//  . B W .
+//  B W . W
+//  . B W .
+static void setup_ko(GameState& state)
+{
+	REQUIRE(play(state, 0, 1));
+	REQUIRE(play(state, 0, 2));
+	REQUIRE(play(state, 1, 0));
+	REQUIRE(play(state, 1, 1));
+	REQUIRE(play(state, 2, 1));
+	REQUIRE(play(state, 2, 2));
+	REQUIRE(play(state, 10, 10));
+	REQUIRE(play(state, 1, 3));
+}
+
+TEST_CASE("zobrist hash is updated incrementally", "[engine][hash]")
+{
+	GameState state;
+	REQUIRE(state.hash == calculate_hash(state.board_state));
+
+	setup_ko(state);
+	REQUIRE(state.hash == calculate_hash(state.board_state));
+
+	Action capture = {BoardState::index(1, 2), state.player_turn};
+	uint64_t expected_hash = get_hash_after_move(state, capture);
+	REQUIRE(make_move(state, capture));
+	REQUIRE(state.board_state(1, 1) == Cell::EMPTY);
+	REQUIRE(state.hash == expected_hash);
+	REQUIRE(state.hash == calculate_hash(state.board_state));
+}
+
+// Three kos, each a stone in atari at the center of:
+//  . B W .
+//  B . . W
+//  . B W .
+// With black to play, A (3, 3) and C (12, 3) hold a white stone and B (3, 11)
+// holds a black one, so that taking them in turn repeats the position after
+// six moves
+static void setup_triple_ko(GameState& state)
+{
+	const uint32_t black[][2] = {{2, 3},  {3, 2},  {4, 3},  {2, 10},
+	                             {3, 9},  {4, 10}, {3, 11}, {11, 3},
+	                             {12, 2}, {13, 3}, {18, 18}};
+	const uint32_t white[][2] = {{2, 4},  {3, 5},  {4, 4},  {3, 3},
+	                             {2, 11}, {3, 12}, {4, 11}, {11, 4},
+	                             {12, 5}, {13, 4}, {12, 3}};
+	for (uint32_t i = 0; i < 11; i++)
+	{
+		REQUIRE(play(state, black[i][0], black[i][1]));
+		REQUIRE(play(state, white[i][0], white[i][1]));
+	}
+	REQUIRE(play(state, 3, 4));
+	REQUIRE(play(state, 3, 10));
+	REQUIRE(play(state, 12, 4));
+	REQUIRE(play(state, 3, 3));
+	REQUIRE(play(state, 3, 11));
+}
+
+TEST_CASE("positional superko forbids repeating a position", "[engine][ko]")
+{
+	GameState state;
+	state.positional_superko = true;
+	setup_triple_ko(state);
+
+	// the capture isn't forbidden by ko, only by the repetition
+	Action capture = {BoardState::index(12, 3), state.player_turn};
+	REQUIRE(state.board_state.ko != capture.pos);
+	REQUIRE(is_superko(state, capture));
+	REQUIRE_FALSE(is_valid_move(state, capture));
+	REQUIRE_FALSE(make_move(state, capture));
+
+	Action elsewhere = {BoardState::index(15, 15), state.player_turn};
+	REQUIRE_FALSE(is_superko(state, elsewhere));
+	REQUIRE(make_move(state, elsewhere));
+
+	GameState simple_ko;
+	setup_triple_ko(simple_ko);
+	REQUIRE(make_move(simple_ko, capture));
+	REQUIRE(simple_ko.hash == simple_ko.hash_history[22]);
+}
+
+TEST_CASE("passing is allowed with positional superko", "[engine][ko]")
+{
+	GameState state;
+	state.positional_superko = true;
+	Action pass = {Action::PASS, state.player_turn};
+	REQUIRE_FALSE(is_superko(state, pass));
+	REQUIRE(is_valid_move(state, pass));
+	REQUIRE(make_move(state, pass));
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(is_terminal_state(state));
+}
+
+TEST_CASE("hash history finds the hashes it holds", "[engine][hash]")
+{
+	// the hashes share their home slot, so they probe past each other
+	using History = HashHistory<8>;
+	History history;
+	const std::array<uint64_t, 5> hashes = {
+	    3, 3 + History::NUM_SLOTS, 4, 3, 3 + 2 * History::NUM_SLOTS};
+	for (uint64_t hash : hashes)
+		history.push_back(hash);
+	for (uint64_t hash : hashes)
+		REQUIRE(history.contains(hash));
+	REQUIRE_FALSE(history.contains(5));
+
+	for (auto end = hashes.end(); end != hashes.begin();)
+	{
+		history.pop_back();
+		end--;
+		for (uint64_t hash : hashes)
+		{
+			const bool kept = std::find(hashes.begin(), end, hash) != end;
+			REQUIRE(history.contains(hash) == kept);
+		}
+	}
+	REQUIRE(history.empty());
+}
+
+TEST_CASE("ko forbids the immediate recapture", "[engine][ko]")
+{
+	GameState state;
+	setup_ko(state);
+	REQUIRE(play(state, 1, 2));
+	REQUIRE(state.board_state.ko == BoardState::index(1, 1));
+
+	Action recapture = {BoardState::index(1, 1), state.player_turn};
+	REQUIRE_FALSE(is_valid_move(state, recapture));
+
+	REQUIRE(play(state, 15, 15));
+	REQUIRE(play(state, 16, 16));
+	REQUIRE(state.board_state.ko == BoardState::INVALID_INDEX);
+	REQUIRE(is_valid_move(state, recapture));
+}
+
+TEST_CASE("two passes in a row end the game", "[engine][history]")
+{
+	GameState state;
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(play(state, 3, 3));
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE_FALSE(is_terminal_state(state));
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(is_terminal_state(state));
+	REQUIRE(state.move_history.size == 4);
+	REQUIRE(state.move_history[1].pos == BoardState::index(3, 3));
+	REQUIRE(state.move_history[1].player_index == 1);
+
+	REQUIRE(unmake_move(state));
+	REQUIRE_FALSE(is_terminal_state(state));
+	REQUIRE(state.consecutive_passes == 1);
+	REQUIRE(unmake_move(state));
+	REQUIRE(unmake_move(state));
+	REQUIRE(state.consecutive_passes == 1);
+}
+
+TEST_CASE("a game past its length limit ends with passes", "[engine][history]")
+{
+	using SmallState = BasicGameState<9>;
+	SmallState state;
+	while (state.move_history.size < SmallState::MAX_NUM_MOVES - 1)
+		REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(play(state, 4, 4));
+	REQUIRE_FALSE(is_terminal_state(state));
+
+	// only passes are left, and the history has room for them
+	REQUIRE_FALSE(is_valid_move(state, {SmallState::BoardState::index(3, 3),
+	                                    state.player_turn}));
+	REQUIRE(is_valid_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE_FALSE(is_terminal_state(state));
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(is_terminal_state(state));
+	REQUIRE(state.move_history.full());
+
+	REQUIRE(unmake_move(state));
+	REQUIRE(is_valid_move(state, {Action::PASS, state.player_turn}));
+}
+
+TEST_CASE("a playout state plays like the game state", "[engine][playout]")
+{
+	std::mt19937 rng(3);
+	GameState state;
+	for (uint32_t i = 0; i < 50; i++)
+		REQUIRE(make_move(state, random_action(state, rng)));
+
+	PlayoutState playout = state;
+	for (uint32_t i = 0; i < 250; i++)
+	{
+		Action action = random_action(state, rng);
+		REQUIRE(make_move(state, action));
+		REQUIRE(make_move(playout, action));
+		REQUIRE(playout.board_state.board == state.board_state.board);
+		REQUIRE(playout.board_state.ko == state.board_state.ko);
+		REQUIRE(playout.hash == state.hash);
+		REQUIRE(playout.legal_moves == state.legal_moves);
+	}
+}
+
+TEST_CASE("pattern codes describe the 3x3 neighborhood", "[engine][pattern]")
+{
+	GameState state;
+	// cells away from the border start with code 0, and the codes don't
+	// depend on the board size
+	REQUIRE(state.patterns[BoardState::index(5, 5)] == 0);
+	REQUIRE(NUM_PATTERNS<19> == NUM_PATTERNS<9>);
+
+	// a stone changes the codes of the 8 cells around it only
+	uint32_t corner = state.patterns[BoardState::index(0, 0)];
+	uint32_t far = state.patterns[BoardState::index(10, 10)];
+	REQUIRE(play(state, 1, 1));
+	REQUIRE(state.patterns[BoardState::index(0, 0)] != corner);
+	REQUIRE(state.patterns[BoardState::index(10, 10)] == far);
+	REQUIRE(
+	    state.patterns[BoardState::index(0, 1)] !=
+	    state.patterns[BoardState::index(2, 1)]);
+
+	// the black stone ends in atari with its last liberty at (0, 1)
+	uint32_t before_atari = state.patterns[BoardState::index(0, 1)];
+	REQUIRE(play(state, 1, 2));
+	REQUIRE(play(state, 10, 10));
+	REQUIRE(play(state, 2, 1));
+	REQUIRE(play(state, 10, 11));
+	REQUIRE(play(state, 1, 0));
+	REQUIRE(state.atari_clusters.contains(BoardState::index(1, 1)));
+	REQUIRE(state.patterns[BoardState::index(0, 1)] != before_atari);
+	REQUIRE(
+	    state.patterns[BoardState::index(0, 1)] ==
+	    calculate_pattern(state, BoardState::index(0, 1)));
+}
+
+TEST_CASE("weighted sampling prefers captures", "[engine][pattern]")
+{
+	// white (1, 1) is left in atari with its liberty at (1, 0), black to play
+	GameState state;
+	REQUIRE(play(state, 1, 2));
+	REQUIRE(play(state, 1, 1));
+	REQUIRE(play(state, 2, 1));
+	REQUIRE(play(state, 10, 10));
+	REQUIRE(play(state, 0, 1));
+	REQUIRE(play(state, 15, 15));
+
+	uint32_t capture = BoardState::index(1, 0);
+	uint32_t weight = state.patterns.weights[0][capture];
+	REQUIRE(weight > state.patterns.weights[0][BoardState::index(5, 5)]);
+
+	std::mt19937 rng(11);
+	uint32_t num_captures = 0;
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		Action action = sample_weighted_action(state, rng);
+		REQUIRE(is_valid_move(state, action));
+		if (action.pos == capture)
+			num_captures++;
+	}
+	// a uniform draw would pick the capture about 3 times
+	double expected = 1000.0 * weight / state.patterns.weights[0].total;
+	REQUIRE(num_captures > expected / 2);
+}
+
+TEST_CASE("playouts don't fill their own eyes", "[engine][playout]")
+{
+	// black surrounds the corner point, white plays far away
+	GameState state;
+	REQUIRE(play(state, 0, 1));
+	REQUIRE(play(state, 10, 10));
+	REQUIRE(play(state, 1, 0));
+	REQUIRE(play(state, 10, 12));
+
+	uint32_t corner = BoardState::index(0, 0);
+	REQUIRE(is_eye_like(state.board_state, corner, 0));
+	REQUIRE_FALSE(is_eye_like(state.board_state, corner, 1));
+	REQUIRE(state.patterns.weights[0][corner] == 0);
+	REQUIRE(state.patterns.weights[1][corner] != 0);
+	for_each_playout_move(
+	    state, [&](const Action& action) { REQUIRE(action.pos != corner); });
+
+	// an enemy stone on the diagonal of an edge point breaks the eye
+	REQUIRE(play(state, 5, 5));
+	REQUIRE(play(state, 1, 1));
+	REQUIRE_FALSE(is_eye_like(state.board_state, corner, 0));
+}
+
+TEST_CASE("playouts end with two passes", "[engine][playout]")
+{
+	std::mt19937 rng(5);
+	BasicPlayoutState<9> state;
+	uint32_t num_moves = 0;
+	while (!is_terminal_state(state) && num_moves < 1000)
+	{
+		std::vector<Action> actions;
+		for_each_playout_move(
+		    state, [&](const Action& action) { actions.push_back(action); });
+		REQUIRE_FALSE(actions.empty());
+		std::uniform_int_distribution<size_t> distribution(
+		    0, actions.size() - 1);
+		REQUIRE(make_move(state, actions[distribution(rng)]));
+		num_moves++;
+	}
+	REQUIRE(is_terminal_state(state));
+
+	BasicPlayoutState<9> weighted_state;
+	num_moves = 0;
+	while (!is_terminal_state(weighted_state) && num_moves < 1000)
+	{
+		Action action = sample_weighted_action(weighted_state, rng);
+		REQUIRE(make_move(weighted_state, action));
+		num_moves++;
+	}
+	REQUIRE(is_terminal_state(weighted_state));
+}
+
+TEST_CASE("the liberty pool holds the most clusters", "[engine][liberties]")
+{
+	// the cells with (i + 2 * j) % 5 == 0 are left empty, each other cell
+	// next to one of them gets a stone of its checkerboard color
+	constexpr uint32_t SIZE = 19;
+	using State = BasicPlayoutState<SIZE>;
+	// the cells off the board, on either side as the indices wrap around,
+	// aren't liberties
+	auto is_liberty = [](uint32_t i, uint32_t j) {
+		return i < SIZE && j < SIZE && (i + 2 * j) % 5 == 0;
+	};
+	State state;
+	uint32_t num_stones = 0;
+	for (uint32_t i = 0; i < SIZE; i++)
+	{
+		for (uint32_t j = 0; j < SIZE; j++)
+		{
+			if (is_liberty(i, j) ||
+			    !(is_liberty(i - 1, j) || is_liberty(i + 1, j) ||
+			      is_liberty(i, j - 1) || is_liberty(i, j + 1)))
+				continue;
+			const uint32_t player = (i + j) % 2;
+			if (state.player_turn != player)
+				REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+			REQUIRE(make_move(state, {State::BoardState::index(i, j), player}));
+			num_stones++;
+		}
+	}
+	REQUIRE(state.players[0].number_captured_enemies == 0);
+	REQUIRE(state.players[1].number_captured_enemies == 0);
+
+	// every stone is a cluster, and only the edges keep the pool from
+	// filling up
+	using Storage = details::LibertyStorage<SIZE, ExactLiberties>;
+	const auto& table = state.cluster_table;
+	REQUIRE(Storage::MAX_NUM_CLUSTERS - table.num_free_liberties == num_stones);
+	REQUIRE(num_stones + SIZE >= Storage::MAX_NUM_CLUSTERS);
+}
+
+TEST_CASE("pseudo liberties play like exact liberties", "[engine][liberties]")
+{
+	std::mt19937 rng(7);
+	GameState exact;
+	BasicGameState<DEFAULT_BOARD_SIZE, PseudoLiberties> pseudo;
+	for (uint32_t i = 0; i < 400; i++)
+	{
+		Action action = random_action(exact, rng);
+		REQUIRE(make_move(exact, action));
+		REQUIRE(make_move(pseudo, action));
+		REQUIRE(pseudo.board_state.board == exact.board_state.board);
+		REQUIRE(pseudo.board_state.ko == exact.board_state.ko);
+		REQUIRE(pseudo.legal_moves == exact.legal_moves);
+		for (uint32_t idx = 0; idx < BoardState::MAX_NUM_CELLS; idx++)
+		{
+			Cell cell = exact.board_state.board[idx];
+			if (cell != Cell::BLACK && cell != Cell::WHITE)
+				continue;
+			const Cluster& exact_cluster =
+			    get_cluster(exact.cluster_table, idx);
+			const Cluster& pseudo_cluster =
+			    get_cluster(pseudo.cluster_table, idx);
+			bool in_atari = is_in_atari(exact.cluster_table, exact_cluster);
+			REQUIRE(
+			    is_in_atari(pseudo.cluster_table, pseudo_cluster) == in_atari);
+			if (in_atari)
+				REQUIRE(
+				    get_atari_liberty(pseudo.cluster_table, pseudo_cluster) ==
+				    get_atari_liberty(exact.cluster_table, exact_cluster));
+		}
+	}
+}
+
+TEMPLATE_TEST_CASE(
+    "analyze_move tells what make_move does", "[engine][analysis]",
+    BasicPlayoutState<9>, (BasicPlayoutState<9, PseudoLiberties>))
+{
+	std::mt19937 rng(21);
+	TestType state;
+	uint32_t num_captures = 0;
+	for (uint32_t i = 0; i < 150; i++)
+	{
+		std::vector<Action> actions;
+		for_each_valid_action(
+		    state, [&](const Action& action) { actions.push_back(action); });
+		for (const Action& action : actions)
+		{
+			MoveEffect effect = analyze_move(state, action);
+			TestType played = state;
+			REQUIRE(make_move(played, action));
+			const auto& player = played.players[action.player_index];
+			REQUIRE(
+			    effect.num_captured_stones ==
+			    player.number_captured_enemies -
+			        state.players[action.player_index].number_captured_enemies);
+			REQUIRE(
+			    effect.num_liberties ==
+			    count_liberties(played.board_state, action.pos));
+			REQUIRE(effect.is_self_atari == (effect.num_liberties == 1));
+			REQUIRE(effect.ko == played.board_state.ko);
+			if (effect.num_captured_stones > 0)
+				num_captures++;
+		}
+		if (actions.empty())
+			break;
+		std::uniform_int_distribution<size_t> distribution(
+		    0, actions.size() - 1);
+		REQUIRE(make_move(state, actions[distribution(rng)]));
+	}
+	REQUIRE(num_captures > 0);
+}
+
+TEMPLATE_TEST_CASE(
+    "unmake_move reverts make_move", "[engine][undo]", BasicGameState<9>,
+    BasicGameState<13>, BasicGameState<19>,
+    (BasicGameState<19, PseudoLiberties>))
+{
+	std::mt19937 rng(42);
+	TestType state;
+	std::vector<TestType> snapshots;
+	for (uint32_t i = 0; i < 300; i++)
+	{
+		snapshots.push_back(state);
+		REQUIRE(make_move(state, random_action(state, rng)));
+		require_consistent_legal_moves(state);
+		require_consistent_ataris(state);
+	}
+	REQUIRE(state.players[0].number_captured_enemies > 0);
+	REQUIRE(state.players[1].number_captured_enemies > 0);
+	// the journal only keeps the last MAX_UNDO_MOVES moves
+	for (uint32_t i = 0; i < MAX_UNDO_MOVES; i++)
+	{
+		REQUIRE(unmake_move(state));
+		require_same_state(state, snapshots.back());
+		require_consistent_legal_moves(state);
+		require_consistent_ataris(state);
+		snapshots.pop_back();
+	}
+	REQUIRE_FALSE(unmake_move(state));
+}
@@ -0,0 +1,46 @@
+#include "includes/catch.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "controller/agent.h"
+#include "controller/game.h"
+#include "engine/board.h"
+
+using namespace go;
+using namespace go::engine;
+
+// Passes, and records the moves it is told about
+class RecordingAgent : public Agent
+{
+public:
+	virtual uint32_t generate_move(const Game&) override
+	{
+		return Action::PASS;
+	}
+	virtual void on_move_played(const Action& action) override
+	{
+		played_moves.push_back(action.pos);
+	}
+
+	std::vector<uint32_t> played_moves;
+};
+
+TEST_CASE("agents are told about the moves played", "[game]")
+{
+	Game game;
+	auto black = std::make_shared<RecordingAgent>();
+	auto white = std::make_shared<RecordingAgent>();
+	REQUIRE(game.register_agent(black, 0));
+	REQUIRE(game.register_agent(white, 1));
+
+	const uint32_t move = BoardState::index(3, 3);
+	REQUIRE(game.make_move({move, 0}));
+	REQUIRE_FALSE(game.make_move({move, 1}));
+	game.main_loop();
+
+	// main_loop plays a pass for each agent, which ends the game
+	const std::vector<uint32_t> expected = {move, Action::PASS, Action::PASS};
+	REQUIRE(black->played_moves == expected);
+	REQUIRE(white->played_moves == expected);
+}
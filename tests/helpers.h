@@ -0,0 +1,37 @@
+#ifndef TESTS_HELPERS_H_
+#define TESTS_HELPERS_H_
+
+#include <random>
+#include <vector>
+
+#include "engine/board.h"
+#include "engine/interface.h"
+#include "engine/utility.h"
+
+template <uint32_t BoardSize, typename Liberties>
+bool play(
+    go::engine::BasicGameState<BoardSize, Liberties>& state, uint32_t i,
+    uint32_t j)
+{
+	using namespace go::engine;
+	uint32_t cell_idx = BasicBoardState<BoardSize>::index(i, j);
+	return make_move(state, {cell_idx, state.player_turn});
+}
+
+template <uint32_t BoardSize, typename Liberties>
+go::engine::Action random_action(
+    const go::engine::BasicGameState<BoardSize, Liberties>& state,
+    std::mt19937& rng)
+{
+	using namespace go::engine;
+	std::vector<Action> actions;
+	for_each_valid_action(state, [&](const Action& action) {
+		actions.push_back(action);
+	});
+	if (actions.empty())
+		return {Action::PASS, state.player_turn};
+	std::uniform_int_distribution<size_t> pick(0, actions.size() - 1);
+	return actions[pick(rng)];
+}
+
+#endif // TESTS_HELPERS_H_
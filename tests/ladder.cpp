@@ -0,0 +1,74 @@
+#include "includes/catch.hpp"
+
+#include "engine/board.h"
+#include "engine/interface.h"
+#include "engine/ladder.h"
+#include "helpers.h"
+
+using namespace go::engine;
+
+// Black (2, 2) is surrounded by white on three sides, with white to play:
+//  . . W . .
+//  . W B . .
+//  . . . W .
+static void setup_ladder(GameState& state)
+{
+	REQUIRE(play(state, 2, 2));
+	REQUIRE(play(state, 1, 2));
+	REQUIRE(play(state, 18, 0));
+	REQUIRE(play(state, 2, 1));
+	REQUIRE(play(state, 18, 2));
+	REQUIRE(play(state, 3, 3));
+	REQUIRE(play(state, 18, 4));
+}
+
+// reading must leave the state as it found it
+static void
+require_ladder(GameState& state, uint32_t i, uint32_t j, bool result)
+{
+	const GameState before = state;
+	CHECK(is_ladder_capture(state, BoardState::index(i, j)) == result);
+	REQUIRE(state.board_state.board == before.board_state.board);
+	REQUIRE(state.board_state.ko == before.board_state.ko);
+	REQUIRE(state.hash == before.hash);
+	REQUIRE(state.player_turn == before.player_turn);
+	REQUIRE(state.number_played_moves == before.number_played_moves);
+	REQUIRE(state.move_history.size == before.move_history.size);
+}
+
+TEST_CASE("a ladder towards the edge is captured", "[ladder]")
+{
+	GameState state;
+	setup_ladder(state);
+	require_ladder(state, 2, 2, true);
+}
+
+TEST_CASE("a cluster with three liberties is not a ladder", "[ladder]")
+{
+	GameState state;
+	setup_ladder(state);
+	REQUIRE(play(state, 10, 10));
+	REQUIRE(play(state, 2, 3));
+	require_ladder(state, 2, 2, false);
+}
+
+TEST_CASE("a ladder escapes by capturing an attacker", "[ladder]")
+{
+	GameState state;
+	setup_ladder(state);
+	// puts white (2, 1) in atari
+	REQUIRE(play(state, 10, 10));
+	REQUIRE(play(state, 1, 1));
+	REQUIRE(play(state, 10, 12));
+	REQUIRE(play(state, 3, 1));
+	require_ladder(state, 2, 2, false);
+}
+
+TEST_CASE("the ladder reader gives up when out of nodes", "[ladder]")
+{
+	GameState state;
+	setup_ladder(state);
+	const uint64_t hash = state.hash;
+	REQUIRE_FALSE(is_ladder_capture(state, BoardState::index(2, 2), 1));
+	REQUIRE(state.hash == hash);
+}
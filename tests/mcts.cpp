@@ -0,0 +1,336 @@
+#include "includes/catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "engine/board.h"
+#include "engine/interface.h"
+#include "helpers.h"
+#include "mcts/mcts.h"
+
+using namespace go::engine;
+using namespace go::mcts;
+
+static constexpr std::chrono::milliseconds NO_TIME_LIMIT{60 * 1000};
+
+// each playout goes through the root and one of its children
+static void require_consistent_root(
+    const MCTSAgent& agent, uint32_t move, uint32_t number_playouts)
+{
+	const NodePool& pool = agent.get_pool();
+	const Node& root = pool[0];
+	REQUIRE(root.visits == number_playouts);
+	uint32_t children_visits = 0;
+	uint32_t max_visits = 0;
+	uint32_t move_visits = 0;
+	for (uint32_t i = 0; i < root.num_children; i++)
+	{
+		const Node& child = pool[root.first_child + i];
+		const uint32_t visits = child.visits;
+		REQUIRE(child.wins <= float(visits));
+		children_visits += visits;
+		max_visits = std::max(max_visits, visits);
+		if (child.move == move)
+			move_visits = visits;
+	}
+	REQUIRE(children_visits == root.visits);
+	REQUIRE(move_visits == max_visits);
+}
+
+// the nodes of the subtree of the node, whose children all come after it
+static uint32_t count_tree_nodes(const NodePool& pool, uint32_t node_idx)
+{
+	const Node& node = pool[node_idx];
+	uint32_t count = 1;
+	if (!node.is_expanded())
+		return count;
+	REQUIRE(node.first_child > node_idx);
+	REQUIRE(node.first_child + node.num_children <= pool.get_size());
+	for (uint32_t i = 0; i < node.num_children; i++)
+		count += count_tree_nodes(pool, node.first_child + i);
+	return count;
+}
+
+TEST_CASE("the MCTS agent plays its most visited move", "[mcts]")
+{
+	GameState state;
+	REQUIRE(play(state, 3, 3));
+	REQUIRE(play(state, 15, 15));
+
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	config.max_playouts = 200;
+	config.num_threads = 1;
+	MCTSAgent agent(config);
+	const uint32_t move = agent.search(state, NO_TIME_LIMIT);
+	REQUIRE(is_valid_move(state, {move, state.player_turn}));
+	REQUIRE(agent.get_number_playouts() == config.max_playouts);
+	require_consistent_root(agent, move, config.max_playouts);
+}
+
+TEST_CASE("MCTS threads share the tree statistics", "[mcts]")
+{
+	GameState state;
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	config.max_playouts = 400;
+	config.num_threads = 4;
+	MCTSAgent agent(config);
+	const uint32_t move = agent.search(state, NO_TIME_LIMIT);
+	REQUIRE(is_valid_move(state, {move, state.player_turn}));
+	REQUIRE(agent.get_number_playouts() == config.max_playouts);
+	require_consistent_root(agent, move, config.max_playouts);
+}
+
+TEST_CASE("the MCTS agent stays within its node pool", "[mcts]")
+{
+	GameState state;
+	SearchConfig config;
+	config.pool_size = 1000;
+	config.max_playouts = 100;
+	MCTSAgent agent(config);
+	const uint32_t move = agent.search(state, NO_TIME_LIMIT);
+	REQUIRE(is_valid_move(state, {move, state.player_turn}));
+	REQUIRE(agent.get_pool().get_size() <= config.pool_size / 2);
+	REQUIRE(agent.get_number_playouts() == config.max_playouts);
+}
+
+TEST_CASE("the MCTS agent stops on time", "[mcts]")
+{
+	GameState state;
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	MCTSAgent agent(config);
+	const auto start = std::chrono::steady_clock::now();
+	agent.search(state, std::chrono::milliseconds(100));
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	REQUIRE(agent.get_number_playouts() >= 1);
+	REQUIRE(elapsed < std::chrono::seconds(1));
+}
+
+TEST_CASE("root parallel MCTS merges the root statistics", "[mcts]")
+{
+	GameState state;
+	REQUIRE(play(state, 3, 3));
+
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	config.max_playouts = 400;
+	config.num_threads = 4;
+	config.mode = SearchMode::ROOT_PARALLEL;
+	MCTSAgent agent(config);
+	const uint32_t move = agent.search(state, NO_TIME_LIMIT);
+	REQUIRE(is_valid_move(state, {move, state.player_turn}));
+	REQUIRE(agent.get_number_playouts() == config.max_playouts);
+	REQUIRE(agent.get_pool().get_capacity() == config.pool_size / 4);
+
+	// every playout is counted once, in the tree of the thread that ran it
+	uint32_t total_visits = 0;
+	uint32_t max_visits = 0;
+	uint32_t move_visits = 0;
+	for (const MoveStatistics& statistics : agent.get_root_statistics())
+	{
+		REQUIRE(is_valid_move(state, {statistics.move, state.player_turn}));
+		REQUIRE(statistics.wins <= float(statistics.visits));
+		total_visits += statistics.visits;
+		max_visits = std::max(max_visits, statistics.visits);
+		if (statistics.move == move)
+			move_visits = statistics.visits;
+	}
+	REQUIRE(total_visits == config.max_playouts);
+	REQUIRE(move_visits == max_visits);
+}
+
+// the merged root children count the playouts of every tree once
+static void require_merged_trees(const MCTSAgent& agent)
+{
+	uint32_t merged_visits = 0;
+	for (const MoveStatistics& statistics : agent.get_root_statistics())
+		merged_visits += statistics.visits;
+	uint32_t trees_visits = 0;
+	for (uint32_t tree = 0; tree < agent.get_number_trees(); tree++)
+	{
+		const NodePool& pool = agent.get_pool(tree);
+		const Node& root = pool[0];
+		uint32_t children_visits = 0;
+		for (uint32_t i = 0; i < root.num_children; i++)
+			children_visits += pool[root.first_child + i].visits;
+		REQUIRE(children_visits == root.visits);
+		trees_visits += root.visits;
+	}
+	REQUIRE(merged_visits == trees_visits);
+}
+
+TEST_CASE("root parallel MCTS sums the visits of its trees", "[mcts]")
+{
+	GameState state;
+	REQUIRE(play(state, 3, 3));
+
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	config.max_playouts = 200;
+	config.num_threads = 2;
+	config.mode = SearchMode::ROOT_PARALLEL;
+	MCTSAgent agent(config);
+	agent.search(state, NO_TIME_LIMIT);
+	REQUIRE(agent.get_number_trees() == config.num_threads);
+	require_merged_trees(agent);
+
+	// the kept trees only hold their own playouts from one search to the
+	// next
+	agent.search(state, NO_TIME_LIMIT);
+	require_merged_trees(agent);
+	uint32_t total_visits = 0;
+	for (const MoveStatistics& statistics : agent.get_root_statistics())
+		total_visits += statistics.visits;
+	REQUIRE(total_visits == 2 * config.max_playouts);
+}
+
+TEST_CASE("the transposition table keeps the most visited positions", "[mcts]")
+{
+	TranspositionTable table(1);
+	const uint64_t num_buckets = table.get_number_buckets();
+	REQUIRE(num_buckets * 64 <= (1 << 20));
+	REQUIRE(table.find(1) == nullptr);
+
+	// keys of the same bucket, the first one gets the fewest visits
+	const uint32_t visits[] = {1, 3, 2, 2};
+	for (uint64_t i = 0; i < TranspositionTable::BUCKET_SIZE; i++)
+		for (uint32_t j = 0; j < visits[i]; j++)
+			table.update(1 + i * num_buckets, 1);
+	for (uint64_t i = 0; i < TranspositionTable::BUCKET_SIZE; i++)
+	{
+		const auto* entry = table.find(1 + i * num_buckets);
+		REQUIRE(entry != nullptr);
+		REQUIRE(entry->visits == visits[i]);
+		REQUIRE(entry->wins == float(visits[i]));
+	}
+
+	const uint64_t new_key = 1 + TranspositionTable::BUCKET_SIZE * num_buckets;
+	table.update(new_key, 0.5f);
+	REQUIRE(table.find(1) == nullptr);
+	REQUIRE(table.find(new_key) != nullptr);
+	REQUIRE(table.find(new_key)->wins == 0.5f);
+	REQUIRE(table.find(1 + num_buckets) != nullptr);
+}
+
+TEST_CASE("the transposition table replaces older searches first", "[mcts]")
+{
+	TranspositionTable table(1);
+	const uint64_t num_buckets = table.get_number_buckets();
+	// the first key gets the fewest visits, and is the only one visited
+	// again by the next search
+	const uint32_t visits[] = {1, 3, 2, 2};
+	for (uint64_t i = 0; i < TranspositionTable::BUCKET_SIZE; i++)
+		for (uint32_t j = 0; j < visits[i]; j++)
+			table.update(1 + i * num_buckets, 1);
+	table.new_search();
+	table.update(1, 0);
+
+	// the previous search's entries are kept
+	for (uint64_t i = 0; i < TranspositionTable::BUCKET_SIZE; i++)
+		REQUIRE(table.find(1 + i * num_buckets) != nullptr);
+	REQUIRE(table.find(1)->visits == 2);
+	REQUIRE(table.find(1)->wins == 1);
+
+	const uint64_t new_key = 1 + TranspositionTable::BUCKET_SIZE * num_buckets;
+	table.update(new_key, 1);
+	REQUIRE(table.find(new_key) != nullptr);
+	REQUIRE(table.find(1) != nullptr);
+	REQUIRE(table.find(1 + 2 * num_buckets) == nullptr);
+}
+
+TEST_CASE("the position key tells the player to move", "[mcts]")
+{
+	GameState state;
+	REQUIRE(play(state, 3, 3));
+	const uint64_t key = get_position_key(state);
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(get_position_key(state) != key);
+	REQUIRE(make_move(state, {Action::PASS, state.player_turn}));
+	REQUIRE(get_position_key(state) == key);
+}
+
+TEST_CASE("MCTS keys its nodes by the positions of the game", "[mcts]")
+{
+	// the tree is searched on a rollout state replayed from the game
+	GameState state;
+	REQUIRE(play(state, 3, 3));
+	REQUIRE(play(state, 15, 15));
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	config.max_playouts = 500;
+	config.num_threads = 1;
+	MCTSAgent agent(config);
+	agent.search(state, NO_TIME_LIMIT);
+
+	const NodePool& pool = agent.get_pool();
+	const Node& root = pool[0];
+	uint32_t num_checked = 0;
+	for (uint32_t i = 0; i < root.num_children; i++)
+	{
+		const Node& child = pool[root.first_child + i];
+		if (child.visits == 0)
+			continue;
+		GameState next = state;
+		REQUIRE(make_move(next, {child.move, next.player_turn}));
+		REQUIRE(child.key == get_position_key(next));
+		num_checked++;
+	}
+	REQUIRE(num_checked > 0);
+}
+
+TEST_CASE("MCTS records its positions in the transposition table", "[mcts]")
+{
+	GameState state;
+	SearchConfig config;
+	config.pool_size = 1 << 16;
+	config.max_playouts = 200;
+	config.num_threads = 2;
+	config.tt_size_mb = 1;
+	MCTSAgent agent(config);
+	agent.search(state, NO_TIME_LIMIT);
+
+	const NodePool& pool = agent.get_pool();
+	const TranspositionTable* table = agent.get_transposition_table();
+	REQUIRE(table != nullptr);
+	const auto* root_entry = table->find(pool[0].key);
+	REQUIRE(root_entry != nullptr);
+	REQUIRE(root_entry->visits == config.max_playouts);
+}
+
+TEST_CASE("MCTS keeps the subtree of the played moves", "[mcts]")
+{
+	GameState state;
+	SearchConfig config;
+	config.pool_size = 1 << 17;
+	config.max_playouts = 300;
+	config.num_threads = 1;
+	MCTSAgent agent(config);
+	const uint32_t move = agent.search(state, NO_TIME_LIMIT);
+	uint32_t move_visits = 0;
+	for (const MoveStatistics& statistics : agent.get_root_statistics())
+		if (statistics.move == move)
+			move_visits = statistics.visits;
+	REQUIRE(move_visits >= 1);
+
+	const Action action = {move, state.player_turn};
+	REQUIRE(make_move(state, action));
+	agent.on_move_played(action);
+	agent.search(state, NO_TIME_LIMIT);
+	const NodePool& pool = agent.get_pool();
+	REQUIRE(pool[0].key == get_position_key(state));
+	REQUIRE(pool[0].visits == move_visits + config.max_playouts);
+
+	// the subtree was moved to the start of the whole pool, a single
+	// thread leaves no node out of the tree
+	REQUIRE(pool.get_capacity() == config.pool_size);
+	REQUIRE(count_tree_nodes(pool, 0) == pool.get_size());
+
+	// a tree of another position is dropped
+	GameState other_state;
+	REQUIRE(play(other_state, 10, 10));
+	agent.on_move_played({Action::PASS, state.player_turn});
+	agent.search(other_state, NO_TIME_LIMIT);
+	REQUIRE(agent.get_pool()[0].visits == config.max_playouts);
+}